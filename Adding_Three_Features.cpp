@@ -3,12 +3,46 @@
 #include <vector>
 #include <iomanip>
 #include <string>
+#include <string_view>
 #include <algorithm>
+#include <numeric>
 #include <map>
+#include <set>
+#include <deque>
+#include <array>
+#include <unordered_map>
 #include <functional>
 #include <memory>
+#include <cstdint>
 #include <ctime>
-#include <sstream>
+#include <cstring>
+#include <cmath>
+#include <cerrno>
+#include <cstdio>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <future>
+#include <charconv>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
 using namespace std;
 
 // ==================== Base Classes (Following LSP) ====================
@@ -27,569 +61,7687 @@ struct Student
     string attendance = "Not Marked";
 };
 
-// Interface for Grade Strategy (LSP: Base class)
-class IGradeStrategy
+// Whether any subject mark was entered. A student imported from a CSV has
+// only a percentage, which is then kept as it is.
+inline bool hasMarks(const float marks[5])
 {
-public:
-    virtual char calculateGrade(float percentage) const = 0;
-    virtual ~IGradeStrategy() = default;
-};
+    return any_of(marks, marks + 5, [](float mark)
+                  { return mark != 0; });
+}
 
-// Interface for Exporters (LSP: Base class)
-class IExporter
-{
-public:
-    virtual void exportData(const vector<Student> &students) const = 0;
-    virtual ~IExporter() = default;
-};
+// ==================== Storage ====================
 
-// Interface for Report Generators (LSP: Base class)
-class IReportGenerator
+// Read-only view of one stored student. The strings point into the mapped
+// snapshot or into the table's own string storage.
+struct StudentView
 {
-public:
-    virtual void generateReport(const vector<Student> &students) const = 0;
-    virtual ~IReportGenerator() = default;
+    string_view name;
+    int rollNo;
+    string_view studentClass;
+    int age;
+    string_view gender;
+    float marks[5];
+    float percentage;
+    char grade;
+    string_view attendance;
 };
 
-// Interface for GradeCalculator
-class IGradeCalculator
+// Open-addressing hash index from roll number to the slot of that student in the
+// student table. Linear probing over a power-of-two table; erase uses backward
+// shifting so lookups never have to step over tombstones. Writes are tracked per
+// page of entries so a save only rewrites the parts of the table that changed.
+class RollIndex
 {
 public:
-    virtual void calculateGrade(Student &s) const = 0;
-    virtual ~IGradeCalculator() = default;
-};
+    struct Entry
+    {
+        int32_t rollNo;
+        uint32_t slot;
+    };
 
-// ==================== Concrete Implementations ====================
+    static constexpr size_t npos = static_cast<size_t>(-1);
+    static constexpr size_t PAGE_ENTRIES = 4096; // 32 KB of entries per dirty flag
 
-// Default Grading Strategy (LSP: Substitutable for IGradeStrategy)
-class DefaultGradeStrategy : public IGradeStrategy
-{
-public:
-    char calculateGrade(float percentage) const override
+private:
+    static constexpr uint32_t EMPTY = 0xFFFFFFFFu;
+
+    Entry *table = nullptr; // points into `owned` or into an attached snapshot
+    vector<Entry> owned;
+    size_t capacity = 0;
+    size_t count = 0;
+    size_t mask = 0;
+    vector<uint8_t> dirtyPages;
+
+    void resetPages(bool dirty)
     {
-        if (percentage >= 90)
-            return 'A';
-        if (percentage >= 80)
-            return 'B';
-        if (percentage >= 70)
-            return 'C';
-        if (percentage >= 60)
-            return 'D';
-        return 'F';
+        dirtyPages.assign((capacity + PAGE_ENTRIES - 1) / PAGE_ENTRIES, dirty);
     }
-};
 
-// Strict Grading Strategy (LSP: Another substitutable implementation)
-class StrictGradeStrategy : public IGradeStrategy
-{
-public:
-    char calculateGrade(float percentage) const override
+    void write(size_t i, const Entry &e)
     {
-        if (percentage >= 95)
-            return 'A';
-        if (percentage >= 85)
-            return 'B';
-        if (percentage >= 75)
-            return 'C';
-        if (percentage >= 65)
-            return 'D';
-        return 'F';
+        table[i] = e;
+        dirtyPages[i / PAGE_ENTRIES] = 1;
     }
-};
 
-// CSV Exporter (LSP: Substitutable for IExporter)
-class CSVExporter : public IExporter
-{
-public:
-    void exportData(const vector<Student> &students) const override
+    static size_t home(int rollNo, size_t mask)
     {
-        ofstream file("students.csv");
-        file << "Roll,Name,Class,Age,Gender,Percentage,Grade,Attendance\n";
-        for (const auto &s : students)
+        // Fibonacci hashing so consecutive roll numbers spread over the table
+        uint64_t h = static_cast<uint32_t>(rollNo) * 0x9E3779B97F4A7C15ull;
+        return static_cast<size_t>(h >> 32) & mask;
+    }
+
+    size_t home(int rollNo) const { return home(rollNo, mask); }
+
+    void rehash(size_t newCapacity)
+    {
+        vector<Entry> grown(newCapacity, Entry{0, EMPTY});
+        size_t newMask = newCapacity - 1;
+        for (size_t j = 0; j < capacity; ++j)
         {
-            file << s.rollNo << "," << s.name << "," << s.studentClass << ","
-                 << s.age << "," << s.gender << "," << s.percentage << ","
-                 << s.grade << "," << s.attendance << "\n";
+            const Entry &e = table[j];
+            if (e.slot == EMPTY)
+                continue;
+            size_t i = home(e.rollNo, newMask);
+            while (grown[i].slot != EMPTY)
+                i = (i + 1) & newMask;
+            grown[i] = e;
         }
-        cout << "Data exported to students.csv\n";
+        owned.swap(grown);
+        table = owned.data();
+        capacity = newCapacity;
+        mask = newMask;
+        resetPages(true);
     }
-};
 
-// Text Report Generator (LSP: Substitutable for IReportGenerator)
-class TextReportGenerator : public IReportGenerator
-{
 public:
-    void generateReport(const vector<Student> &students) const override
+    RollIndex() { clear(); }
+    RollIndex(const RollIndex &) = delete;
+    RollIndex &operator=(const RollIndex &) = delete;
+
+    size_t size() const { return count; }
+    size_t tableSize() const { return capacity; }
+    const Entry *entries() const { return table; }
+
+    size_t pageCount() const { return dirtyPages.size(); }
+    bool pageDirty(size_t page) const { return dirtyPages[page] != 0; }
+    void markClean() { resetPages(false); }
+
+    void clear()
     {
-        string cls;
-        cout << "Enter class to view report: ";
-        cin >> cls;
+        owned.assign(16, Entry{0, EMPTY});
+        table = owned.data();
+        capacity = 16;
+        mask = 15;
+        count = 0;
+        resetPages(true);
+    }
 
-        bool found = false;
-        for (const auto &s : students)
+    static bool validShape(size_t entryCapacity, size_t entryCount)
+    {
+        return entryCapacity >= 16 && (entryCapacity & (entryCapacity - 1)) == 0 &&
+               entryCount * 10 <= entryCapacity * 7;
+    }
+
+    // Takes over a table that was assembled from a saved snapshot
+    bool adopt(vector<Entry> entries, size_t entryCount)
+    {
+        if (!validShape(entries.size(), entryCount))
+            return false;
+        owned.swap(entries);
+        table = owned.data();
+        capacity = owned.size();
+        mask = capacity - 1;
+        count = entryCount;
+        resetPages(false);
+        return true;
+    }
+
+    // Uses a table that was saved earlier (e.g. inside a mapped snapshot) in place.
+    // The memory must stay valid and writable for as long as the index is used.
+    bool attach(Entry *entries, size_t entryCapacity, size_t entryCount)
+    {
+        if (!validShape(entryCapacity, entryCount))
+            return false;
+        vector<Entry>().swap(owned);
+        table = entries;
+        capacity = entryCapacity;
+        mask = entryCapacity - 1;
+        count = entryCount;
+        resetPages(false);
+        return true;
+    }
+
+    // Make room for n entries without growing again (load factor stays <= 0.7)
+    void reserve(size_t n)
+    {
+        size_t newCapacity = capacity;
+        while (n * 10 > newCapacity * 7)
+            newCapacity *= 2;
+        if (newCapacity != capacity)
+            rehash(newCapacity);
+    }
+
+    size_t find(int rollNo) const
+    {
+        for (size_t i = home(rollNo);; i = (i + 1) & mask)
+        {
+            if (table[i].slot == EMPTY)
+                return npos;
+            if (table[i].rollNo == rollNo)
+                return table[i].slot;
+        }
+    }
+
+    // Returns false (and leaves the index untouched) if rollNo is already present
+    bool insert(int rollNo, size_t slot)
+    {
+        reserve(count + 1);
+        size_t i = home(rollNo);
+        for (; table[i].slot != EMPTY; i = (i + 1) & mask)
+        {
+            if (table[i].rollNo == rollNo)
+                return false;
+        }
+        write(i, Entry{rollNo, static_cast<uint32_t>(slot)});
+        ++count;
+        return true;
+    }
+
+    // Repoint an existing roll number at a new slot (used when records move)
+    void update(int rollNo, size_t slot)
+    {
+        for (size_t i = home(rollNo); table[i].slot != EMPTY; i = (i + 1) & mask)
         {
-            if (s.studentClass == cls)
+            if (table[i].rollNo == rollNo)
             {
-                cout << s.rollNo << "\t" << s.name << "\t" << s.grade << "\t"
-                     << s.percentage << "%\n";
-                found = true;
+                write(i, Entry{rollNo, static_cast<uint32_t>(slot)});
+                return;
             }
         }
-        if (!found)
+    }
+
+    bool erase(int rollNo)
+    {
+        size_t i = home(rollNo);
+        for (; table[i].slot != EMPTY; i = (i + 1) & mask)
         {
-            cout << "No students found in class " << cls << "\n";
+            if (table[i].rollNo == rollNo)
+                break;
+        }
+        if (table[i].slot == EMPTY)
+            return false;
+
+        // Backward-shift the rest of the probe run into the hole
+        size_t hole = i;
+        for (size_t j = (i + 1) & mask; table[j].slot != EMPTY; j = (j + 1) & mask)
+        {
+            size_t h = home(table[j].rollNo);
+            bool movable = (hole <= j) ? (h <= hole || h > j) : (h <= hole && h > j);
+            if (movable)
+            {
+                write(hole, table[j]);
+                hole = j;
+            }
         }
+        write(hole, Entry{0, EMPTY});
+        --count;
+        return true;
     }
 };
 
-// ==================== Core Management Classes ====================
-
-class GradeCalculator : public IGradeCalculator
+// A whole file mapped private and writable. Pages that get written are copied by
+// the kernel, so patches made in memory never reach the file on disk.
+class MappedFile
 {
-    shared_ptr<IGradeStrategy> strategy;
+    char *base = nullptr;
+    size_t length = 0;
 
 public:
-    explicit GradeCalculator(shared_ptr<IGradeStrategy> strat) : strategy(move(strat)) {}
+    MappedFile() = default;
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
 
-    void calculateGrade(Student &s) const override
+    ~MappedFile()
     {
-        float total = 0;
-        for (float mark : s.marks)
-            total += mark;
-        s.percentage = total / 5;
-        s.grade = strategy->calculateGrade(s.percentage);
+        if (base)
+            munmap(base, length);
     }
-};
 
-class FileHandler
-{
-public:
-    static void saveToFile(const vector<Student> &students, const string &filename = "students.txt")
+    bool open(const string &filename)
     {
-        ofstream file(filename);
-        for (const auto &s : students)
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0)
         {
-            file << s.name << " " << s.rollNo << " " << s.studentClass << " "
-                 << s.age << " " << s.gender;
-            for (float mark : s.marks)
-                file << " " << mark;
-            file << " " << s.attendance << "\n";
+            ::close(fd);
+            return false;
         }
+        void *mapping = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapping == MAP_FAILED)
+            return false;
+        base = static_cast<char *>(mapping);
+        length = st.st_size;
+        return true;
     }
 
-    static vector<Student> loadFromFile(const string &filename = "students.txt")
-    {
-        vector<Student> students;
-        ifstream file(filename);
-        Student s;
-        while (file >> s.name >> s.rollNo >> s.studentClass >> s.age >> s.gender >> s.marks[0] >> s.marks[1] >> s.marks[2] >> s.marks[3] >> s.marks[4] >> s.attendance)
-        {
-            students.push_back(s);
-        }
-        return students;
-    }
+    char *data() const { return base; }
+    size_t size() const { return length; }
 };
 
-class AuthManager
+// Bump allocator for the table's variable-length text. Strings are copied
+// back to back into large blocks and are never freed one by one; clear()
+// drops them all at once. Views into the arena stay valid until then.
+class TextArena
 {
-private:
-    static string username;
-    static string password;
+    static constexpr size_t BLOCK_BYTES = 256 << 10;
+
+    vector<unique_ptr<char[]>> blocks;
+    char *next = nullptr;
+    size_t left = 0;
+    size_t capacityBytes = 0;
+    size_t usedBytes = 0;
+
+    void addBlock(size_t bytes)
+    {
+        blocks.emplace_back(new char[bytes]);
+        next = blocks.back().get();
+        left = bytes;
+        capacityBytes += bytes;
+    }
 
 public:
-    static bool authenticate()
+    TextArena() = default;
+    TextArena(const TextArena &) = delete;
+    TextArena &operator=(const TextArena &) = delete;
+
+    // Makes room for `bytes` more text in a single block
+    void reserve(size_t bytes)
     {
-        string user, pass;
-        cout << "Username: ";
-        cin >> user;
-        cout << "Password: ";
-        cin >> pass;
-        return user == username && pass == password;
+        if (bytes > left)
+            addBlock(bytes);
     }
 
-    // Feature 1: Update Password
-    static void updatePassword()
+    string_view store(string_view value)
     {
-        string newPass, confirmPass;
-        cout << "Enter new password: ";
-        cin >> newPass;
-        cout << "Confirm new password: ";
-        cin >> confirmPass;
-        if (newPass == confirmPass)
-        {
-            password = newPass;
-            cout << "Password updated successfully.\n";
-        }
-        else
-        {
-            cout << "Passwords do not match. Update failed.\n";
-        }
+        if (value.size() > left)
+            addBlock(max(BLOCK_BYTES, value.size()));
+        char *text = next;
+        memcpy(text, value.data(), value.size());
+        next += value.size();
+        left -= value.size();
+        usedBytes += value.size();
+        return string_view(text, value.size());
     }
-};
 
-// Initialize static members
-string AuthManager::username = "admin";
-string AuthManager::password = "1234";
+    void clear()
+    {
+        blocks.clear();
+        next = nullptr;
+        left = capacityBytes = usedBytes = 0;
+    }
 
-// ==================== Student Operations ====================
+    size_t used() const { return usedBytes; }
+    size_t capacity() const { return capacityBytes; }
+};
 
-class StudentOperations
+// Interned values of the low-cardinality text columns (class, gender and
+// attendance). Every distinct value gets a 16-bit id in the order it was first
+// seen and keeps it, so rows store two bytes per field instead of a string view
+// and snapshots store the ids as they are. Id 0 is always the empty string.
+class SymbolTable
 {
-protected:
-    vector<Student> students;
-    shared_ptr<IGradeCalculator> gradeCalc; // Changed to interface
+    deque<string> values;                    // id -> value; deque keeps the strings in place
+    unordered_map<string_view, uint16_t> ids; // views into values
+    bool warned = false;
 
 public:
-    StudentOperations(shared_ptr<IGradeCalculator> strategy) // Modified constructor
-        : gradeCalc(move(strategy))
+    static constexpr size_t MAX_SYMBOLS = 65536;
+
+    SymbolTable() { intern(""); }
+    SymbolTable(const SymbolTable &) = delete;
+    SymbolTable &operator=(const SymbolTable &) = delete;
+    SymbolTable(SymbolTable &&) = default;
+    SymbolTable &operator=(SymbolTable &&) = default;
+
+    size_t size() const { return values.size(); }
+
+    void clear()
     {
+        values.clear();
+        ids.clear();
+        intern("");
     }
 
-    virtual void addStudent()
-    {
-        Student s;
-        cout << "Enter name: ";
-        cin.ignore();
-        getline(cin, s.name);
-        cout << "Enter roll number: ";
-        cin >> s.rollNo;
-        cout << "Enter class: ";
-        cin.ignore();
-        getline(cin, s.studentClass);
-        cout << "Enter age: ";
-        cin >> s.age;
-        cout << "Enter gender: ";
-        cin.ignore();
-        getline(cin, s.gender);
+    string_view name(uint16_t id) const { return id < values.size() ? string_view(values[id]) : string_view(); }
 
-        gradeCalc->calculateGrade(s); // Use interface
-        students.push_back(s);
-        cout << "Student added successfully.\n";
+    // Same values under the same ids, for a snapshot of the table
+    SymbolTable copy() const
+    {
+        SymbolTable table;
+        for (size_t id = 1; id < values.size(); ++id)
+            table.intern(values[id]);
+        return table;
     }
 
-    virtual void viewAllStudents() const
+    // Id of a value, or -1 if it has never been interned
+    int find(string_view value) const
     {
-        cout << left << setw(10) << "Roll" << setw(20) << "Name" << setw(10) << "Class"
-             << setw(6) << "Age" << setw(10) << "Gender" << setw(10) << "Percentage"
-             << setw(8) << "Grade" << "Attendance\n";
+        auto it = ids.find(value);
+        return it == ids.end() ? -1 : it->second;
+    }
 
-        for (const auto &s : students)
+    uint16_t intern(string_view value)
+    {
+        auto it = ids.find(value);
+        if (it != ids.end())
+            return it->second;
+        if (values.size() == MAX_SYMBOLS)
         {
-            cout << setw(10) << s.rollNo << setw(20) << s.name << setw(10) << s.studentClass
-                 << setw(6) << s.age << setw(10) << s.gender << setw(10) << fixed
-                 << setprecision(2) << s.percentage << setw(8) << s.grade << s.attendance << "\n";
+            if (!warned)
+                cout << "Warning: more than " << MAX_SYMBOLS
+                     << " distinct class, gender and attendance values; the rest are stored blank.\n";
+            warned = true;
+            return 0;
         }
+        uint16_t id = static_cast<uint16_t>(values.size());
+        values.emplace_back(value);
+        ids.emplace(values.back(), id);
+        return id;
     }
 
-    virtual void searchStudent() const
+    // Heap bytes held by the values and the lookup table
+    size_t memoryBytes() const
     {
-        int roll;
-        cout << "Enter roll number: ";
-        cin >> roll;
+        size_t bytes = values.size() * (sizeof(string) + sizeof(pair<string_view, uint16_t>) + 2 * sizeof(void *));
+        for (const auto &value : values)
+            bytes += value.capacity() > 15 ? value.capacity() + 1 : 0;
+        return bytes + ids.bucket_count() * sizeof(void *);
+    }
+};
 
-        auto it = find_if(students.begin(), students.end(),
-                          [roll](const Student &s)
-                          { return s.rollNo == roll; });
+// Column-oriented student storage. Rows are grouped into fixed-size segments; a
+// segment either points straight into a mapped snapshot or owns its columns. A
+// mapped segment is copied into memory the first time one of its rows changes,
+// so loading costs nothing per row and a session only pays for what it touches.
+// Every changed row sets a dirty bit, so a save only has to rewrite the
+// segments that actually contain changes.
+//
+// snapshot() pins the table as it is for a reader that runs while it keeps
+// changing (multi-version concurrency). The snapshot shares every segment; a
+// segment that a pinned snapshot can see is copied before its next change, so
+// writers never wait for readers and readers never see half a change. The
+// columns a copy replaces are retired with the current epoch and go back to the
+// free list once every snapshot pinned before that epoch is gone (epoch-based
+// reclamation), a few at a time as writers need columns.
+class StudentTable
+{
+public:
+    static constexpr size_t SEGMENT_ROWS = 1024;
 
-        if (it != students.end())
-        {
-            const auto &s = *it;
-            cout << "\nStudent Details:\n"
-                 << "Name: " << s.name << "\n"
-                 << "Class: " << s.studentClass << "\n"
-                 << "Age: " << s.age << "\n"
-                 << "Gender: " << s.gender << "\n"
-                 << "Percentage: " << s.percentage << "%\n"
-                 << "Grade: " << s.grade << "\n";
-        }
-        else
-        {
-            cout << "Student not found.\n";
-        }
-    }
+    enum TextField
+    {
+        NAME,
+        CLASS,
+        GENDER,
+        ATTENDANCE,
+        TEXT_FIELDS
+    };
 
-    virtual void updateStudent()
+    // CLASS, GENDER and ATTENDANCE are stored as symbol ids, at field - 1
+    static constexpr int SYMBOL_FIELDS = TEXT_FIELDS - 1;
+
+    // Columns of one segment inside a mapped snapshot
+    struct MappedSegment
     {
-        int roll;
-        cout << "Enter roll number to update: ";
-        cin >> roll;
+        size_t rows;
+        const int32_t *rollNo;
+        const int32_t *age;
+        const float *marks[5];
+        const float *percentage;
+        const char *grade;
+        const uint32_t *name; // offsets of length-prefixed strings in heap
+        const uint16_t *symbol[SYMBOL_FIELDS];
+        const char *heap;
+        uint64_t heapBytes;
+    };
+
+private:
+    struct OwnedColumns
+    {
+        int32_t rollNo[SEGMENT_ROWS];
+        int32_t age[SEGMENT_ROWS];
+        float marks[5][SEGMENT_ROWS];
+        float percentage[SEGMENT_ROWS];
+        char grade[SEGMENT_ROWS];
+        string_view name[SEGMENT_ROWS];
+        uint16_t symbol[SYMBOL_FIELDS][SEGMENT_ROWS];
+    };
+
+    struct Segment
+    {
+        size_t rows = 0;
+        uint64_t ownedAt = 0; // epoch the owned columns were made in
+        uint64_t dirty[SEGMENT_ROWS / 64] = {}; // rows changed since the last save
+        const int32_t *rollNo = nullptr;
+        const int32_t *age = nullptr;
+        const float *marks[5] = {};
+        const float *percentage = nullptr;
+        const char *grade = nullptr;
+        const uint16_t *symbol[SYMBOL_FIELDS] = {};
+        const uint32_t *nameOffset = nullptr; // mapped segments only
+        const char *heap = nullptr;
+        uint64_t heapBytes = 0;
+        OwnedColumns *owned = nullptr; // from columnBlocks
+    };
+
+    // Memory the rows point into. Snapshots hold on to it, so clear() starts
+    // over with a new one rather than freeing what a snapshot still reads.
+    struct Storage
+    {
+        shared_ptr<MappedFile> file;
+        TextArena names; // names written since the snapshot was mapped
+        // Owned columns are carved out of a few large blocks and recycled through
+        // a free list, so filling the table costs one allocation per block rather
+        // than one per segment
+        vector<unique_ptr<OwnedColumns[]>> columnBlocks;
 
-        auto it = find_if(students.begin(), students.end(),
-                          [roll](const Student &s)
-                          { return s.rollNo == roll; });
+        mutex lock;
+        map<uint64_t, size_t> pinned; // epoch -> snapshots taken in it
+        atomic<size_t> readers{0};    // snapshots alive
+        atomic<uint64_t> newest{0};   // newest epoch a snapshot was ever taken in
 
-        if (it != students.end())
+        void pin(uint64_t epoch)
         {
-            Student &s = *it;
-            cout << "Enter new name: ";
-            cin.ignore();
-            getline(cin, s.name);
-            cout << "Enter new class: ";
-            getline(cin, s.studentClass);
-            cout << "Enter new age: ";
-            cin >> s.age;
-            cout << "Enter new gender: ";
-            cin.ignore();
-            getline(cin, s.gender);
+            lock_guard<mutex> guard(lock);
+            ++pinned[epoch];
+            readers.fetch_add(1);
+            if (newest.load() < epoch)
+                newest.store(epoch);
+        }
 
-            gradeCalc->calculateGrade(s); // Use interface
-            cout << "Student updated successfully.\n";
+        void unpin(uint64_t epoch)
+        {
+            lock_guard<mutex> guard(lock);
+            auto it = pinned.find(epoch);
+            if (--it->second == 0)
+                pinned.erase(it);
+            readers.fetch_sub(1);
         }
-        else
+
+        // Whether a snapshot pinned before `epoch` may still read what was retired in it
+        bool pinnedBefore(uint64_t epoch)
         {
-            cout << "Student not found.\n";
+            lock_guard<mutex> guard(lock);
+            return !pinned.empty() && pinned.begin()->first < epoch;
         }
-    }
+    };
 
-    virtual void deleteStudent()
+    struct Retired
     {
-        int roll;
-        cout << "Enter roll number to delete: ";
-        cin >> roll;
+        uint64_t epoch;
+        OwnedColumns *columns;
+    };
 
-        auto new_end = remove_if(students.begin(), students.end(),
-                                 [roll](const Student &s)
-                                 { return s.rollNo == roll; });
+    vector<Segment> segments;
+    size_t count = 0;
+    shared_ptr<Storage> storage = make_shared<Storage>();
+    SymbolTable symbols;
+    vector<OwnedColumns *> freeColumns;
+    deque<Retired> retired;              // columns snapshots may still read, oldest first
+    mutable atomic<uint64_t> epoch{1};   // advanced by every snapshot
+    uint64_t pinnedAt = 0;               // in a snapshot, its epoch
 
-        if (new_end != students.end())
-        {
-            students.erase(new_end, students.end());
-            cout << "Student deleted successfully.\n";
-        }
-        else
+    void addColumnBlock(size_t segmentsInBlock)
+    {
+        auto &blocks = storage->columnBlocks;
+        blocks.emplace_back(new OwnedColumns[segmentsInBlock]);
+        freeColumns.reserve(freeColumns.size() + segmentsInBlock);
+        for (size_t k = segmentsInBlock; k-- > 0;)
+            freeColumns.push_back(&blocks.back()[k]);
+    }
+
+    // Frees the retired columns that no snapshot can read any more
+    void reclaim()
+    {
+        while (!retired.empty() && !storage->pinnedBefore(retired.front().epoch))
         {
-            cout << "Student not found.\n";
+            freeColumns.push_back(retired.front().columns);
+            retired.pop_front();
         }
     }
 
-    virtual void sortStudents()
+    OwnedColumns *newColumns()
     {
-        sort(students.begin(), students.end(),
-             [](const Student &a, const Student &b)
-             { return a.rollNo < b.rollNo; });
-        cout << "Students sorted by roll number.\n";
+        if (!retired.empty())
+            reclaim();
+        if (freeColumns.empty())
+            addColumnBlock(max<size_t>(segments.size() / 4, 1));
+        OwnedColumns *columns = freeColumns.back();
+        freeColumns.pop_back();
+        return columns;
     }
 
-    void saveData() const
+    // Whether a live snapshot shares the owned columns of g
+    bool shared(const Segment &g) const
     {
-        FileHandler::saveToFile(students);
-        cout << "Data saved successfully.\n";
+        return g.owned && storage->readers.load() && g.ownedAt <= storage->newest.load();
     }
 
+    void releaseColumns(Segment &g)
+    {
+        if (shared(g))
+            retired.push_back(Retired{epoch.load(), g.owned});
+        else if (g.owned)
+            freeColumns.push_back(g.owned);
+        g.owned = nullptr;
+    }
+
+    void takeColumns(Segment &g, OwnedColumns *columns)
+    {
+        g.owned = columns;
+        g.ownedAt = epoch.load();
+        pointAtOwned(g);
+    }
+
+    static void pointAtOwned(Segment &g)
+    {
+        OwnedColumns &c = *g.owned;
+        g.rollNo = c.rollNo;
+        g.age = c.age;
+        for (int m = 0; m < 5; ++m)
+            g.marks[m] = c.marks[m];
+        g.percentage = c.percentage;
+        g.grade = c.grade;
+        for (int f = 0; f < SYMBOL_FIELDS; ++f)
+            g.symbol[f] = c.symbol[f];
+        g.nameOffset = nullptr;
+    }
+
+    static string_view decode(const Segment &g, uint32_t offset)
+    {
+        uint32_t length;
+        if (uint64_t(offset) + sizeof(length) > g.heapBytes)
+            return {};
+        memcpy(&length, g.heap + offset, sizeof(length));
+        if (length > g.heapBytes - offset - sizeof(length))
+            return {};
+        return string_view(g.heap + offset + sizeof(length), length);
+    }
+
+    void markDirty(size_t slot)
+    {
+        size_t i = slot % SEGMENT_ROWS;
+        segments[slot / SEGMENT_ROWS].dirty[i / 64] |= uint64_t(1) << (i % 64);
+    }
+
+    // Copy-on-write: gives a segment its own columns before the first change,
+    // and new ones before the first change a snapshot would see
+    OwnedColumns &own(size_t index)
+    {
+        Segment &g = segments[index];
+        if (shared(g))
+        {
+            OwnedColumns *columns = newColumns();
+            *columns = *g.owned; // names are views, so they can be shared
+            retired.push_back(Retired{epoch.load(), g.owned});
+            takeColumns(g, columns);
+        }
+        else if (!g.owned)
+        {
+            OwnedColumns *columns = newColumns();
+            copy_n(g.rollNo, g.rows, columns->rollNo);
+            copy_n(g.age, g.rows, columns->age);
+            for (int m = 0; m < 5; ++m)
+                copy_n(g.marks[m], g.rows, columns->marks[m]);
+            copy_n(g.percentage, g.rows, columns->percentage);
+            copy_n(g.grade, g.rows, columns->grade);
+            for (int f = 0; f < SYMBOL_FIELDS; ++f)
+                copy_n(g.symbol[f], g.rows, columns->symbol[f]);
+            for (size_t i = 0; i < g.rows; ++i)
+                columns->name[i] = decode(g, g.nameOffset[i]);
+            takeColumns(g, columns);
+        }
+        return *g.owned;
+    }
+
+    const Segment &segmentOf(size_t slot) const { return segments[slot / SEGMENT_ROWS]; }
+
+    void setText(OwnedColumns &c, size_t i, TextField field, string_view value)
+    {
+        if (field != NAME)
+        {
+            // Most updates keep the class, gender and attendance they had
+            if (symbols.name(c.symbol[field - 1][i]) != value)
+                c.symbol[field - 1][i] = symbols.intern(value);
+        }
+        else if (c.name[i] != value)
+        {
+            c.name[i] = storage->names.store(value);
+        }
+    }
+
+    // Copies every column of a row; the name view points into the snapshot or
+    // into this table, so it can be shared
+    void copyColumns(OwnedColumns &c, size_t i, size_t from) const
+    {
+        const Segment &g = segmentOf(from);
+        size_t j = from % SEGMENT_ROWS;
+        c.rollNo[i] = g.rollNo[j];
+        c.age[i] = g.age[j];
+        for (int m = 0; m < 5; ++m)
+            c.marks[m][i] = g.marks[m][j];
+        c.percentage[i] = g.percentage[j];
+        c.grade[i] = g.grade[j];
+        c.name[i] = text(from, NAME);
+        for (int f = 0; f < SYMBOL_FIELDS; ++f)
+            c.symbol[f][i] = g.symbol[f][j];
+    }
+
+public:
+    StudentTable() = default;
+    StudentTable(const StudentTable &) = delete;
+    StudentTable &operator=(const StudentTable &) = delete;
+
+    ~StudentTable()
+    {
+        if (pinnedAt)
+            storage->unpin(pinnedAt);
+    }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    void clear()
+    {
+        segments.clear();
+        count = 0;
+        storage = make_shared<Storage>();
+        symbols.clear();
+        freeColumns.clear();
+        retired.clear();
+    }
+
+    // The table as it is now, unchanged by anything done to it later. Take it
+    // with changes excluded, like any other read; reading it afterwards needs
+    // no lock. Costs a copy of the segment list and the symbol table.
+    shared_ptr<const StudentTable> snapshot() const
+    {
+        auto copy = make_shared<StudentTable>();
+        copy->storage = storage;
+        copy->pinnedAt = epoch.fetch_add(1);
+        storage->pin(copy->pinnedAt);
+        copy->segments = segments;
+        copy->count = count;
+        copy->symbols = symbols.copy();
+        return copy;
+    }
+
+    // Snapshots alive and columns waiting for them to go
+    size_t snapshotsAlive() const { return storage->readers.load(); }
+    size_t retiredSegments() const { return retired.size(); }
+
+    // Serves the roster from a mapped snapshot without copying any rows. Every
+    // segment but the last must be full; the symbol ids in the segments are ids
+    // in `table`.
+    void attach(shared_ptr<MappedFile> mapping, const vector<MappedSegment> &mapped, SymbolTable table)
+    {
+        clear();
+        storage->file = move(mapping);
+        symbols = move(table);
+        segments.resize(mapped.size());
+        for (size_t k = 0; k < segments.size(); ++k)
+        {
+            const MappedSegment &m = mapped[k];
+            Segment &g = segments[k];
+            g.rows = m.rows;
+            g.rollNo = m.rollNo;
+            g.age = m.age;
+            for (int s = 0; s < 5; ++s)
+                g.marks[s] = m.marks[s];
+            g.percentage = m.percentage;
+            g.grade = m.grade;
+            for (int f = 0; f < SYMBOL_FIELDS; ++f)
+                g.symbol[f] = m.symbol[f];
+            g.nameOffset = m.name;
+            g.heap = m.heap;
+            g.heapBytes = m.heapBytes;
+            count += m.rows;
+        }
+    }
+
+    size_t segmentCount() const { return segments.size(); }
+
+    // Sizes the table for `rows` rows and up to `textBytes` of new names up
+    // front, so filling it allocates nothing more
+    void reserve(size_t rows, size_t textBytes = 0)
+    {
+        size_t target = (rows + SEGMENT_ROWS - 1) / SEGMENT_ROWS;
+        segments.reserve(target);
+        size_t owned = 0;
+        for (const auto &g : segments)
+            owned += g.owned != nullptr;
+        size_t wanted = target - min(target, owned);
+        if (wanted > freeColumns.size())
+            addColumnBlock(wanted - freeColumns.size());
+        storage->names.reserve(textBytes);
+    }
+
+    bool segmentDirty(size_t index) const
+    {
+        const Segment &g = segments[index];
+        return any_of(begin(g.dirty), end(g.dirty), [](uint64_t bits)
+                      { return bits != 0; });
+    }
+
+    // Rows changed since the last save (or since loading)
+    size_t dirtyRows() const
+    {
+        size_t rows = 0;
+        for (const auto &g : segments)
+        {
+            for (uint64_t bits : g.dirty)
+                rows += __builtin_popcountll(bits);
+        }
+        return rows;
+    }
+
+    void markClean()
+    {
+        for (auto &g : segments)
+            fill(begin(g.dirty), end(g.dirty), 0);
+    }
+
+    // In-memory bytes per row of an owned segment, and what a row took when
+    // class, gender and attendance were string views instead of symbol ids
+    static constexpr size_t rowBytes() { return sizeof(OwnedColumns) / SEGMENT_ROWS; }
+    static constexpr size_t rowBytesWithViews()
+    {
+        return rowBytes() + SYMBOL_FIELDS * (sizeof(string_view) - sizeof(uint16_t));
+    }
+
+    // Bytes of the names written since the snapshot was mapped
+    size_t nameBytes() const { return storage->names.used(); }
+
+    // Rows that have been copied out of the mapped snapshot (or added since)
+    size_t ownedRows() const
+    {
+        size_t rows = 0;
+        for (const auto &g : segments)
+        {
+            if (g.owned)
+                rows += g.rows;
+        }
+        return rows;
+    }
+
+    int rollNo(size_t slot) const { return segmentOf(slot).rollNo[slot % SEGMENT_ROWS]; }
+    int age(size_t slot) const { return segmentOf(slot).age[slot % SEGMENT_ROWS]; }
+    float mark(size_t slot, int subject) const { return segmentOf(slot).marks[subject][slot % SEGMENT_ROWS]; }
+    float percentage(size_t slot) const { return segmentOf(slot).percentage[slot % SEGMENT_ROWS]; }
+    char grade(size_t slot) const { return segmentOf(slot).grade[slot % SEGMENT_ROWS]; }
+
+    const SymbolTable &symbolTable() const { return symbols; }
+
+    // Symbol id of a CLASS, GENDER or ATTENDANCE value
+    uint16_t symbol(size_t slot, TextField field) const
+    {
+        return segmentOf(slot).symbol[field - 1][slot % SEGMENT_ROWS];
+    }
+
+    string_view text(size_t slot, TextField field) const
+    {
+        const Segment &g = segmentOf(slot);
+        size_t i = slot % SEGMENT_ROWS;
+        if (field != NAME)
+            return symbols.name(g.symbol[field - 1][i]);
+        return g.owned ? g.owned->name[i] : decode(g, g.nameOffset[i]);
+    }
+
+    string_view name(size_t slot) const { return text(slot, NAME); }
+    string_view studentClass(size_t slot) const { return text(slot, CLASS); }
+    string_view gender(size_t slot) const { return text(slot, GENDER); }
+    string_view attendance(size_t slot) const { return text(slot, ATTENDANCE); }
+
+    StudentView view(size_t slot) const
+    {
+        StudentView v;
+        v.name = text(slot, NAME);
+        v.rollNo = rollNo(slot);
+        v.studentClass = text(slot, CLASS);
+        v.age = age(slot);
+        v.gender = text(slot, GENDER);
+        for (int m = 0; m < 5; ++m)
+            v.marks[m] = mark(slot, m);
+        v.percentage = percentage(slot);
+        v.grade = grade(slot);
+        v.attendance = text(slot, ATTENDANCE);
+        return v;
+    }
+
+    // Owning copy of a row, for code that edits a student and writes it back
+    Student get(size_t slot) const
+    {
+        StudentView v = view(slot);
+        Student s;
+        s.name = string(v.name);
+        s.rollNo = v.rollNo;
+        s.studentClass = string(v.studentClass);
+        s.age = v.age;
+        s.gender = string(v.gender);
+        copy(begin(v.marks), end(v.marks), s.marks);
+        s.percentage = v.percentage;
+        s.grade = v.grade;
+        s.attendance = string(v.attendance);
+        return s;
+    }
+
+    void set(size_t slot, const Student &s)
+    {
+        size_t i = slot % SEGMENT_ROWS;
+        OwnedColumns &c = own(slot / SEGMENT_ROWS);
+        markDirty(slot);
+        c.rollNo[i] = s.rollNo;
+        c.age[i] = s.age;
+        for (int m = 0; m < 5; ++m)
+            c.marks[m][i] = s.marks[m];
+        c.percentage[i] = s.percentage;
+        c.grade[i] = s.grade;
+        setText(c, i, NAME, s.name);
+        setText(c, i, CLASS, s.studentClass);
+        setText(c, i, GENDER, s.gender);
+        setText(c, i, ATTENDANCE, s.attendance);
+    }
+
+    void setGrade(size_t slot, float percentage, char grade)
+    {
+        size_t i = slot % SEGMENT_ROWS;
+        OwnedColumns &c = own(slot / SEGMENT_ROWS);
+        markDirty(slot);
+        c.percentage[i] = percentage;
+        c.grade[i] = grade;
+    }
+
+    size_t segmentRows(size_t index) const { return segments[index].rows; }
+
+    void segmentMarks(size_t index, const float *marks[5]) const
+    {
+        for (int m = 0; m < 5; ++m)
+            marks[m] = segments[index].marks[m];
+    }
+
+    const float *segmentPercentages(size_t index) const { return segments[index].percentage; }
+
+    // Calls fn(marks, percentage, grade, rows) with the columns of each segment
+    // in turn, so a whole column can be regraded at once; every row counts as changed
+    template <typename Fn>
+    void updateGrades(Fn fn)
+    {
+        for (size_t k = 0; k < segments.size(); ++k)
+        {
+            OwnedColumns &c = own(k);
+            Segment &g = segments[k];
+            for (size_t w = 0; w * 64 < g.rows; ++w)
+                g.dirty[w] = g.rows - w * 64 >= 64 ? ~uint64_t(0) : (uint64_t(1) << (g.rows - w * 64)) - 1;
+            const float *marks[5] = {c.marks[0], c.marks[1], c.marks[2], c.marks[3], c.marks[4]};
+            fn(marks, c.percentage, c.grade, g.rows);
+        }
+    }
+
+    void setAttendance(size_t slot, string_view attendance)
+    {
+        markDirty(slot);
+        setText(own(slot / SEGMENT_ROWS), slot % SEGMENT_ROWS, ATTENDANCE, attendance);
+    }
+
+    void append(const Student &s)
+    {
+        if (segments.empty() || segments.back().rows == SEGMENT_ROWS)
+        {
+            segments.emplace_back();
+            takeColumns(segments.back(), newColumns());
+        }
+        own(segments.size() - 1);
+        ++segments.back().rows;
+        ++count;
+        set(count - 1, s);
+    }
+
+    // Overwrites row `to` with a copy of row `from`
+    void copyRow(size_t from, size_t to)
+    {
+        OwnedColumns &c = own(to / SEGMENT_ROWS);
+        markDirty(to);
+        copyColumns(c, to % SEGMENT_ROWS, from);
+    }
+
+    void popBack()
+    {
+        markDirty(count - 1); // the segment shrinks, so it has to be written again
+        if (--segments.back().rows == 0)
+        {
+            releaseColumns(segments.back());
+            segments.pop_back();
+        }
+        --count;
+    }
+};
+
+// Order-statistics tree over (percentage, roll number), best first: higher
+// percentages come first and ties go to the lower roll number. A treap whose
+// nodes carry subtree sizes, so inserting, removing, ranking a student and
+// finding the k-th best are all O(log n). Nodes live in one vector and are
+// recycled through a free list.
+class RankTree
+{
+    struct Node
+    {
+        float percentage;
+        int32_t rollNo;
+        uint32_t priority;
+        uint32_t size;
+        uint32_t left, right;
+    };
+
+    static constexpr uint32_t NIL = 0; // nodes[0] is an empty sentinel of size 0
+
+    vector<Node> nodes{Node{0, 0, 0, 0, NIL, NIL}};
+    vector<uint32_t> unused;
+    uint32_t root = NIL;
+    uint32_t seed = 2463534242u;
+
+    static bool before(float p1, int r1, float p2, int r2)
+    {
+        return p1 > p2 || (p1 == p2 && r1 < r2);
+    }
+
+    uint32_t nextPriority()
+    {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        return seed;
+    }
+
+    void pull(uint32_t t)
+    {
+        nodes[t].size = 1 + nodes[nodes[t].left].size + nodes[nodes[t].right].size;
+    }
+
+    // l receives the keys that come before (p, r), right the rest
+    void split(uint32_t t, float p, int r, uint32_t &l, uint32_t &rest)
+    {
+        if (t == NIL)
+        {
+            l = rest = NIL;
+            return;
+        }
+        if (before(nodes[t].percentage, nodes[t].rollNo, p, r))
+        {
+            split(nodes[t].right, p, r, nodes[t].right, rest);
+            l = t;
+        }
+        else
+        {
+            split(nodes[t].left, p, r, l, nodes[t].left);
+            rest = t;
+        }
+        pull(t);
+    }
+
+    uint32_t merge(uint32_t a, uint32_t b)
+    {
+        if (a == NIL || b == NIL)
+            return a == NIL ? b : a;
+        if (nodes[a].priority > nodes[b].priority)
+        {
+            nodes[a].right = merge(nodes[a].right, b);
+            pull(a);
+            return a;
+        }
+        nodes[b].left = merge(a, nodes[b].left);
+        pull(b);
+        return b;
+    }
+
+    uint32_t allocate(float percentage, int rollNo)
+    {
+        Node n{percentage, rollNo, nextPriority(), 1, NIL, NIL};
+        if (unused.empty())
+        {
+            nodes.push_back(n);
+            return nodes.size() - 1;
+        }
+        uint32_t t = unused.back();
+        unused.pop_back();
+        nodes[t] = n;
+        return t;
+    }
+
+    template <typename Fn>
+    void visit(uint32_t t, size_t &skip, size_t &left, Fn &fn) const
+    {
+        if (t == NIL || left == 0)
+            return;
+        if (skip >= nodes[t].size)
+        {
+            skip -= nodes[t].size;
+            return;
+        }
+        visit(nodes[t].left, skip, left, fn);
+        if (left == 0)
+            return;
+        if (skip)
+        {
+            --skip;
+        }
+        else
+        {
+            fn(nodes[t].percentage, nodes[t].rollNo);
+            --left;
+        }
+        visit(nodes[t].right, skip, left, fn);
+    }
+
+public:
+    size_t size() const { return nodes[root].size; }
+
+    // Builds the tree from unsorted keys in O(n log n)
+    void assign(vector<pair<float, int>> keys)
+    {
+        nodes.resize(1);
+        unused.clear();
+        root = NIL;
+        sort(keys.begin(), keys.end(), [](const pair<float, int> &a, const pair<float, int> &b)
+             { return before(a.first, a.second, b.first, b.second); });
+        // Keys arrive in order, so the treap can be built left to right along
+        // its right spine (the usual Cartesian-tree construction)
+        vector<uint32_t> spine;
+        for (const auto &key : keys)
+        {
+            uint32_t t = allocate(key.first, key.second), last = NIL;
+            while (!spine.empty() && nodes[spine.back()].priority < nodes[t].priority)
+            {
+                last = spine.back();
+                spine.pop_back();
+                pull(last);
+            }
+            nodes[t].left = last;
+            if (!spine.empty())
+                nodes[spine.back()].right = t;
+            spine.push_back(t);
+        }
+        root = spine.empty() ? NIL : spine.front();
+        while (!spine.empty())
+        {
+            pull(spine.back());
+            spine.pop_back();
+        }
+    }
+
+    void insert(float percentage, int rollNo)
+    {
+        uint32_t l, r;
+        split(root, percentage, rollNo, l, r);
+        root = merge(merge(l, allocate(percentage, rollNo)), r);
+    }
+
+    void erase(float percentage, int rollNo)
+    {
+        uint32_t l, r;
+        split(root, percentage, rollNo, l, r);
+        // r starts with the key itself, if it is there
+        uint32_t t = r, parent = NIL;
+        while (t != NIL && nodes[t].left != NIL)
+        {
+            parent = t;
+            t = nodes[t].left;
+        }
+        if (t != NIL && nodes[t].percentage == percentage && nodes[t].rollNo == rollNo)
+        {
+            // Every subtree on the way down to t loses one node
+            for (uint32_t p = r; p != t; p = nodes[p].left)
+                --nodes[p].size;
+            if (parent == NIL)
+                r = nodes[t].right;
+            else
+                nodes[parent].left = nodes[t].right;
+            unused.push_back(t);
+        }
+        root = merge(l, r);
+    }
+
+    // Number of students ranked ahead of (percentage, rollNo)
+    size_t countBefore(float percentage, int rollNo) const
+    {
+        size_t count = 0;
+        for (uint32_t t = root; t != NIL;)
+        {
+            if (before(nodes[t].percentage, nodes[t].rollNo, percentage, rollNo))
+            {
+                count += nodes[nodes[t].left].size + 1;
+                t = nodes[t].right;
+            }
+            else
+            {
+                t = nodes[t].left;
+            }
+        }
+        return count;
+    }
+
+    // Number of students above a percentage (or at least at it, if inclusive)
+    size_t countAbove(float percentage, bool inclusive) const
+    {
+        size_t count = 0;
+        for (uint32_t t = root; t != NIL;)
+        {
+            float p = nodes[t].percentage;
+            if (p > percentage || (inclusive && p == percentage))
+            {
+                count += nodes[nodes[t].left].size + 1;
+                t = nodes[t].right;
+            }
+            else
+            {
+                t = nodes[t].left;
+            }
+        }
+        return count;
+    }
+
+    // Calls fn(percentage, rollNo) for ranks [from, from + count), best first
+    template <typename Fn>
+    void forRanks(size_t from, size_t count, Fn fn) const
+    {
+        visit(root, from, count, fn);
+    }
+};
+
+// Stable reference to a student. It keeps naming the same student while
+// other rows are deleted (which moves the last row) or added, and stops
+// resolving once that student is deleted.
+struct StudentHandle
+{
+    uint32_t index = UINT32_MAX;
+    uint32_t generation = 0;
+};
+
+// Generation-checked handles over the slots of a StudentTable. The table
+// stays dense (a delete moves the last row into the hole), and the map follows
+// every move, so a handle resolves to its student's current slot with two
+// array reads. Entries of deleted students go on a free list and are reused by
+// the next insert with a bumped generation, which makes old handles to them
+// fail the check instead of naming the newcomer. Because reuse is immediate,
+// the entry array never grows past the largest the roster has been.
+class SlotMap
+{
+public:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+private:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    struct Entry
+    {
+        uint32_t slot;       // slot of the student, or the next free entry
+        uint32_t generation; // bumped when the entry is freed
+    };
+
+    bool ready = false;
+    vector<Entry> entries;
+    vector<uint32_t> entryOfSlot;
+    uint32_t freeHead = NONE;
+
+public:
+    bool built() const { return ready; }
+
+    void clear()
+    {
+        ready = false;
+        entries.clear();
+        entryOfSlot.clear();
+        freeHead = NONE;
+    }
+
+    // One fresh handle per row of a table with `rows` rows
+    void assign(size_t rows)
+    {
+        clear();
+        entries.resize(rows);
+        entryOfSlot.resize(rows);
+        for (size_t slot = 0; slot < rows; ++slot)
+        {
+            entries[slot] = Entry{static_cast<uint32_t>(slot), 0};
+            entryOfSlot[slot] = slot;
+        }
+        ready = true;
+    }
+
+    // Upper bound of the handle indices in use
+    size_t capacity() const { return entries.size(); }
+
+    // A row was appended at slot (== the previous row count)
+    StudentHandle insert(size_t slot)
+    {
+        if (!ready)
+            return {};
+        uint32_t e = freeHead;
+        if (e != NONE)
+        {
+            freeHead = entries[e].slot;
+        }
+        else
+        {
+            e = entries.size();
+            entries.push_back(Entry{0, 0});
+        }
+        entries[e].slot = slot;
+        entryOfSlot.push_back(e);
+        return StudentHandle{e, entries[e].generation};
+    }
+
+    // Mirrors StudentOperations::removeByRoll: slot is dropped and the last
+    // slot moves into its place
+    void remove(size_t slot)
+    {
+        if (!ready)
+            return;
+        uint32_t e = entryOfSlot[slot], moved = entryOfSlot.back();
+        entryOfSlot[slot] = moved;
+        entries[moved].slot = slot;
+        entryOfSlot.pop_back();
+        entries[e].generation++;
+        entries[e].slot = freeHead;
+        freeHead = e;
+    }
+
+    StudentHandle handleOf(size_t slot) const
+    {
+        uint32_t e = entryOfSlot[slot];
+        return StudentHandle{e, entries[e].generation};
+    }
+
+    // Current slot of a handle's student, or npos once it has been deleted
+    size_t slotOf(StudentHandle handle) const
+    {
+        if (!ready || handle.index >= entries.size() || entries[handle.index].generation != handle.generation)
+            return npos;
+        return entries[handle.index].slot;
+    }
+
+    // Slot of a live handle index, as handed out by handleOf or insert
+    size_t slotAt(uint32_t index) const { return entries[index].slot; }
+};
+
+// Secondary index from class to its students, so class-scoped queries only
+// touch that class. Class names are interned to small ids; each class keeps an
+// unordered list of student handles (SlotMap), and every handle remembers its
+// position in that list, so deletes are O(1) and rows moving in the table
+// leave the index untouched. Each class also keeps running
+// totals (count, sums of percentages, their squares and the subject marks of
+// the students that have any, and a grade histogram), so its statistics never need a scan, and a ranking
+// (RankTree) that is built the first time a leaderboard of the class is asked
+// for. Built on the first class query and kept in step with the roster from
+// then on.
+class ClassIndex
+{
+public:
+    static constexpr uint32_t npos = UINT32_MAX;
+
+    struct Stats
+    {
+        size_t count = 0;
+        size_t marked = 0; // students with marks, which subjectSums cover
+        double percentageSum = 0;
+        double percentageSquares = 0;
+        double subjectSums[5] = {};
+        uint32_t grades[128] = {}; // students per grade letter
+
+        double average() const { return count ? percentageSum / count : 0; }
+        double deviation() const
+        {
+            if (!count)
+                return 0;
+            double mean = average();
+            return sqrt(max(percentageSquares / count - mean * mean, 0.0));
+        }
+    };
+
+private:
+    bool ready = false;
+    deque<string> names;                      // id -> class name
+    unordered_map<string_view, uint32_t> ids; // views into names
+    vector<vector<uint32_t>> members;         // id -> handle indices
+    vector<Stats> totals;                     // id -> running totals
+    vector<unique_ptr<RankTree>> rankings;    // id -> ranking, null until first used
+    const SlotMap *handles = nullptr;
+    vector<uint32_t> classOfHandle;
+    vector<uint32_t> position; // handle -> index in members[classOfHandle[handle]]
+
+    uint32_t intern(string_view cls)
+    {
+        auto it = ids.find(cls);
+        if (it != ids.end())
+            return it->second;
+        uint32_t id = names.size();
+        names.emplace_back(cls);
+        ids.emplace(names.back(), id);
+        members.emplace_back();
+        totals.emplace_back();
+        rankings.emplace_back();
+        return id;
+    }
+
+    void link(uint32_t handle, uint32_t id)
+    {
+        classOfHandle[handle] = id;
+        position[handle] = members[id].size();
+        members[id].push_back(handle);
+    }
+
+    void unlink(uint32_t handle)
+    {
+        auto &list = members[classOfHandle[handle]];
+        uint32_t moved = list.back();
+        list[position[handle]] = moved;
+        position[moved] = position[handle];
+        list.pop_back();
+    }
+
+    // Adds (sign = 1) or takes away (sign = -1) one student's share of the totals
+    static void account(Stats &t, float percentage, char grade, const float marks[5], int sign)
+    {
+        t.count += sign;
+        t.percentageSum += sign * double(percentage);
+        t.percentageSquares += sign * double(percentage) * percentage;
+        if (hasMarks(marks))
+        {
+            t.marked += sign;
+            for (int m = 0; m < 5; ++m)
+                t.subjectSums[m] += sign * double(marks[m]);
+        }
+        t.grades[grade & 0x7f] += sign;
+    }
+
+    static void account(Stats &t, const StudentTable &students, size_t slot, int sign)
+    {
+        float marks[5];
+        for (int m = 0; m < 5; ++m)
+            marks[m] = students.mark(slot, m);
+        account(t, students.percentage(slot), students.grade(slot), marks, sign);
+    }
+
+public:
+    bool built() const { return ready; }
+
+    // Drops the index; the next class query rebuilds it
+    void clear()
+    {
+        ready = false;
+        names.clear();
+        ids.clear();
+        members.clear();
+        totals.clear();
+        rankings.clear();
+        handles = nullptr;
+        classOfHandle.clear();
+        position.clear();
+    }
+
+    // `map` must be built and is followed from then on
+    void build(const StudentTable &students, const SlotMap &map)
+    {
+        clear();
+        handles = &map;
+        classOfHandle.resize(map.capacity());
+        position.resize(map.capacity());
+        // Class ids by symbol id, so each distinct class is hashed only once
+        vector<uint32_t> bySymbol(students.symbolTable().size(), npos);
+        for (size_t slot = 0; slot < students.size(); ++slot)
+        {
+            uint16_t symbol = students.symbol(slot, StudentTable::CLASS);
+            uint32_t &id = bySymbol[symbol];
+            if (id == npos)
+                id = intern(students.symbolTable().name(symbol));
+            link(map.handleOf(slot).index, id);
+            account(totals[id], students, slot, 1);
+        }
+        ready = true;
+    }
+
+    // A student was appended at slot; call after the slot map has its handle
+    void insert(size_t slot, const Student &s)
+    {
+        if (!ready)
+            return;
+        uint32_t handle = handles->handleOf(slot).index;
+        if (handle >= classOfHandle.size())
+        {
+            classOfHandle.resize(handle + 1);
+            position.resize(handle + 1);
+        }
+        uint32_t id = intern(s.studentClass);
+        link(handle, id);
+        account(totals[id], s.percentage, s.grade, s.marks, 1);
+        if (rankings[id])
+            rankings[id]->insert(s.percentage, s.rollNo);
+    }
+
+    // The student at slot is being deleted. Call before the table and the
+    // slot map change.
+    void remove(const StudentTable &students, size_t slot)
+    {
+        if (!ready)
+            return;
+        uint32_t handle = handles->handleOf(slot).index, id = classOfHandle[handle];
+        account(totals[id], students, slot, -1);
+        if (rankings[id])
+            rankings[id]->erase(students.percentage(slot), students.rollNo(slot));
+        unlink(handle);
+    }
+
+    // The row at slot is about to be replaced by s. Call before the table changes.
+    void update(const StudentTable &students, size_t slot, const Student &s)
+    {
+        if (!ready)
+            return;
+        uint32_t handle = handles->handleOf(slot).index, old = classOfHandle[handle];
+        account(totals[old], students, slot, -1);
+        uint32_t id = intern(s.studentClass);
+        if (id != old)
+        {
+            unlink(handle);
+            link(handle, id);
+        }
+        account(totals[id], s.percentage, s.grade, s.marks, 1);
+
+        float percentage = students.percentage(slot);
+        if (id != old || percentage != s.percentage)
+        {
+            if (rankings[old])
+                rankings[old]->erase(percentage, students.rollNo(slot));
+            if (rankings[id])
+                rankings[id]->insert(s.percentage, s.rollNo);
+        }
+    }
+
+    // Id of a class, or npos if no student has ever been in it
+    uint32_t find(string_view cls) const
+    {
+        auto it = ids.find(cls);
+        return it == ids.end() ? npos : it->second;
+    }
+
+    size_t classCount() const { return names.size(); }
+    string_view className(uint32_t id) const { return names[id]; }
+    uint32_t classOf(size_t slot) const { return classOfHandle[handles->handleOf(slot).index]; }
+
+    // Slots of a class, in no particular order (empty for an unknown class)
+    vector<uint32_t> slotsOf(string_view cls) const
+    {
+        vector<uint32_t> slots;
+        uint32_t id = find(cls);
+        if (id == npos)
+            return slots;
+        slots.reserve(members[id].size());
+        for (uint32_t handle : members[id])
+            slots.push_back(handles->slotAt(handle));
+        return slots;
+    }
+
+    // Running totals of a class (all zero for an unknown class)
+    const Stats &statsOf(string_view cls) const
+    {
+        static const Stats none;
+        uint32_t id = find(cls);
+        return id == npos ? none : totals[id];
+    }
+
+    // Ranking of a class (null for an unknown class), built on first use
+    const RankTree *rankingOf(const StudentTable &students, string_view cls)
+    {
+        uint32_t id = find(cls);
+        if (id == npos)
+            return nullptr;
+        if (!rankings[id])
+        {
+            vector<pair<float, int>> keys;
+            keys.reserve(members[id].size());
+            for (uint32_t handle : members[id])
+            {
+                size_t slot = handles->slotAt(handle);
+                keys.emplace_back(students.percentage(slot), students.rollNo(slot));
+            }
+            rankings[id] = make_unique<RankTree>();
+            rankings[id]->assign(move(keys));
+        }
+        return rankings[id].get();
+    }
+
+    // Totals of a class summed from scratch, to check the running ones
+    Stats recompute(const StudentTable &students, string_view cls) const
+    {
+        Stats t;
+        for (uint32_t slot : slotsOf(cls))
+            account(t, students, slot, 1);
+        return t;
+    }
+
+    // Same counts, and sums equal up to rounding
+    static bool agree(const Stats &a, const Stats &b)
+    {
+        auto close = [](double x, double y)
+        { return fabs(x - y) <= 1e-9 * max(1.0, max(fabs(x), fabs(y))); };
+        if (a.count != b.count || a.marked != b.marked || !equal(begin(a.grades), end(a.grades), begin(b.grades)) ||
+            !close(a.percentageSum, b.percentageSum) || !close(a.percentageSquares, b.percentageSquares))
+            return false;
+        for (int m = 0; m < 5; ++m)
+        {
+            if (!close(a.subjectSums[m], b.subjectSums[m]))
+                return false;
+        }
+        return true;
+    }
+};
+
+// Small fixed-size thread pool for bulk work (imports, exports, regrading)
+class ThreadPool
+{
+    vector<thread> workers;
+    deque<function<void()>> tasks;
+    mutex lock;
+    condition_variable wake;
+    bool stopping = false;
+
+    void workLoop()
+    {
+        while (true)
+        {
+            function<void()> task;
+            {
+                unique_lock<mutex> guard(lock);
+                wake.wait(guard, [this]
+                          { return stopping || !tasks.empty(); });
+                if (tasks.empty())
+                    return;
+                task = move(tasks.front());
+                tasks.pop_front();
+            }
+            task();
+        }
+    }
+
+public:
+    explicit ThreadPool(size_t threads)
+    {
+        for (size_t i = 0; i < max<size_t>(threads, 1); ++i)
+            workers.emplace_back(&ThreadPool::workLoop, this);
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    ~ThreadPool()
+    {
+        {
+            lock_guard<mutex> guard(lock);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto &worker : workers)
+            worker.join();
+    }
+
+    size_t size() const { return workers.size(); }
+
+    template <typename Fn>
+    future<invoke_result_t<Fn>> submit(Fn fn)
+    {
+        auto task = make_shared<packaged_task<invoke_result_t<Fn>()>>(move(fn));
+        future<invoke_result_t<Fn>> result = task->get_future();
+        {
+            lock_guard<mutex> guard(lock);
+            tasks.emplace_back([task]
+                               { (*task)(); });
+        }
+        wake.notify_one();
+        return result;
+    }
+};
+
+// Orders the roster can be sorted in
+enum class SortKey : uint8_t
+{
+    ROLL,
+    NAME,             // case-insensitive
+    CLASS_PERCENTAGE, // class name, then best percentage first
+    AGE,
+    COUNT
+};
+
+// Computes the permutation that sorts the roster without moving any rows.
+// Every row becomes a compact (key, slot) pair and the pairs are LSD radix
+// sorted a byte at a time, skipping bytes that are the same in every key.
+// Names are keyed by their first 8 bytes, case-folded, and runs that tie on
+// that prefix are finished with a full comparison. From PARALLEL_ROWS rows on,
+// building the keys and the counting and scattering of every pass are split
+// across the pool. All sorts are stable: ties keep their current order.
+class RosterSort
+{
+public:
+    static constexpr size_t PARALLEL_ROWS = 1 << 18;
+
+private:
+    template <typename Key>
+    struct Item
+    {
+        Key key;
+        uint32_t slot;
+    };
+
+    // Runs fn(part) for parts [0, parts), on the pool when there is more than one
+    template <typename Fn>
+    static void forParts(ThreadPool *pool, size_t parts, Fn fn)
+    {
+        if (parts == 1)
+        {
+            fn(0);
+            return;
+        }
+        vector<future<void>> done;
+        for (size_t part = 0; part < parts; ++part)
+            done.push_back(pool->submit([&fn, part]
+                                        { fn(part); }));
+        for (auto &f : done)
+            f.get();
+    }
+
+    static size_t partsFor(ThreadPool *pool, size_t rows)
+    {
+        return pool && pool->size() > 1 && rows >= PARALLEL_ROWS ? pool->size() : 1;
+    }
+
+    template <typename Key>
+    static void radixSort(Item<Key> *items, size_t n, ThreadPool *pool)
+    {
+        constexpr size_t BYTES = sizeof(Key);
+        size_t parts = partsFor(pool, n), per = (n + parts - 1) / parts;
+        if (n < 2)
+            return;
+
+        // One read of the keys counts the digits of every pass
+        vector<array<size_t, 256>> counts(parts * BYTES);
+        forParts(pool, parts, [&](size_t part)
+                 {
+                     array<size_t, 256> *count = &counts[part * BYTES];
+                     for (size_t b = 0; b < BYTES; ++b)
+                         count[b].fill(0);
+                     for (size_t i = part * per, end = min(n, i + per); i < end; ++i)
+                     {
+                         Key key = items[i].key;
+                         for (size_t b = 0; b < BYTES; ++b)
+                             ++count[b][(key >> (8 * b)) & 0xff];
+                     } });
+
+        vector<Item<Key>> scratch(n);
+        Item<Key> *from = items, *to = scratch.data();
+        vector<array<size_t, 256>> offset(parts);
+        for (size_t b = 0; b < BYTES; ++b)
+        {
+            // A byte every key shares does not reorder anything
+            size_t digitTotal[256] = {};
+            for (size_t part = 0; part < parts; ++part)
+            {
+                for (size_t d = 0; d < 256; ++d)
+                    digitTotal[d] += counts[part * BYTES + b][d];
+            }
+            if (*max_element(begin(digitTotal), end(digitTotal)) == n)
+                continue;
+
+            // Part p writes its digit d after all smaller digits and after
+            // the digit d rows of parts before it, which keeps the pass stable
+            size_t next = 0;
+            for (size_t d = 0; d < 256; ++d)
+            {
+                for (size_t part = 0; part < parts; ++part)
+                {
+                    offset[part][d] = next;
+                    next += counts[part * BYTES + b][d];
+                }
+            }
+            forParts(pool, parts, [&](size_t part)
+                     {
+                         array<size_t, 256> &at = offset[part];
+                         for (size_t i = part * per, end = min(n, i + per); i < end; ++i)
+                             to[at[(from[i].key >> (8 * b)) & 0xff]++] = from[i];
+                     });
+            swap(from, to);
+        }
+        if (from != items)
+            copy_n(from, n, items);
+    }
+
+    template <typename Key>
+    static void radixSort(vector<Item<Key>> &items, ThreadPool *pool)
+    {
+        radixSort(items.data(), items.size(), pool);
+    }
+
+    // Bytes [depth, depth + 8) of a name, case-folded and zero-padded
+    static uint64_t namePrefix(string_view name, size_t depth)
+    {
+        uint64_t prefix = 0;
+        for (size_t i = depth; i < depth + 8; ++i)
+            prefix = prefix << 8 | (i < name.size() ? static_cast<unsigned char>(fold(name[i])) : 0);
+        return prefix;
+    }
+
+    // Finishes the order of items already sorted on name bytes [0, depth):
+    // each run that ties there is radix sorted on the next 8 bytes, and runs
+    // that are small, or whose names all end within those bytes, are finished
+    // with a full comparison
+    static void sortNameRuns(const StudentTable &students, Item<uint64_t> *items, size_t n, size_t depth)
+    {
+        auto byName = [&](const Item<uint64_t> &a, const Item<uint64_t> &b)
+        { return nameLess(students.name(a.slot), students.name(b.slot)); };
+        for (size_t i = 0; i < n;)
+        {
+            size_t j = i + 1;
+            while (j < n && items[j].key == items[i].key)
+                ++j;
+            size_t run = j - i;
+            bool longer = false;
+            for (size_t k = i; k < j && !longer; ++k)
+                longer = students.name(items[k].slot).size() > depth;
+            if (run > 1 && (run < 32 || !longer))
+            {
+                stable_sort(items + i, items + j, byName);
+            }
+            else if (run > 1)
+            {
+                for (size_t k = i; k < j; ++k)
+                    items[k].key = namePrefix(students.name(items[k].slot), depth);
+                radixSort(items + i, run, nullptr);
+                sortNameRuns(students, items + i, run, depth + 8);
+            }
+            i = j;
+        }
+    }
+
+    // Fills items[i] = {keyOf(slot), slot} for slot = from[i] (or i without
+    // from), split across the pool for big rosters
+    template <typename Key, typename KeyFn>
+    static vector<Item<Key>> keys(size_t rows, const vector<size_t> *from, ThreadPool *pool, KeyFn keyOf)
+    {
+        vector<Item<Key>> items(rows);
+        size_t parts = partsFor(pool, rows), per = (rows + parts - 1) / parts;
+        forParts(pool, parts, [&](size_t part)
+                 {
+                     for (size_t i = part * per, end = min(rows, i + per); i < end; ++i)
+                     {
+                         size_t slot = from ? (*from)[i] : i;
+                         items[i] = Item<Key>{keyOf(slot), static_cast<uint32_t>(slot)};
+                     } });
+        return items;
+    }
+
+    // Classes in name order: rank[id] is the position of symbol id
+    static vector<uint16_t> classRanks(const SymbolTable &symbols)
+    {
+        vector<uint16_t> byName(symbols.size()), rank(symbols.size());
+        iota(byName.begin(), byName.end(), 0);
+        sort(byName.begin(), byName.end(), [&](uint16_t a, uint16_t b)
+             { return symbols.name(a) < symbols.name(b); });
+        for (size_t r = 0; r < byName.size(); ++r)
+            rank[byName[r]] = r;
+        return rank;
+    }
+
+    template <typename Key>
+    static vector<size_t> slots(const vector<Item<Key>> &items)
+    {
+        vector<size_t> order(items.size());
+        for (size_t i = 0; i < items.size(); ++i)
+            order[i] = items[i].slot;
+        return order;
+    }
+
+    static char fold(char c) { return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c; }
+
+    // Floats in an order-preserving unsigned encoding
+    static uint32_t floatKey(float value)
+    {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        return bits & 0x80000000u ? ~bits : bits | 0x80000000u;
+    }
+
+public:
+    // Case-insensitive byte-wise order of names
+    static bool nameLess(string_view a, string_view b)
+    {
+        return lexicographical_compare(a.begin(), a.end(), b.begin(), b.end(), [](char x, char y)
+                                       { return static_cast<unsigned char>(fold(x)) < static_cast<unsigned char>(fold(y)); });
+    }
+
+    // Whether slot a comes before slot b when listed by key. Unlike order(),
+    // which keeps ties where they are, ties go by roll number, so this is a
+    // strict total order of the roster.
+    static bool before(const StudentTable &students, SortKey key, size_t a, size_t b)
+    {
+        switch (key)
+        {
+        case SortKey::NAME:
+        {
+            string_view x = students.name(a), y = students.name(b);
+            if (nameLess(x, y))
+                return true;
+            if (nameLess(y, x))
+                return false;
+            break;
+        }
+        case SortKey::CLASS_PERCENTAGE:
+        {
+            uint16_t x = students.symbol(a, StudentTable::CLASS), y = students.symbol(b, StudentTable::CLASS);
+            if (x != y)
+                return students.symbolTable().name(x) < students.symbolTable().name(y);
+            uint32_t p = floatKey(students.percentage(a)), q = floatKey(students.percentage(b));
+            if (p != q)
+                return p > q;
+            break;
+        }
+        case SortKey::AGE:
+            if (students.age(a) != students.age(b))
+                return students.age(a) < students.age(b);
+            break;
+        default:
+            break;
+        }
+        return students.rollNo(a) < students.rollNo(b);
+    }
+
+    // order[k] is the slot that belongs at position k. With from, only those
+    // slots are sorted, and ties keep their order in from.
+    static vector<size_t> order(const StudentTable &students, SortKey key, ThreadPool *pool = nullptr,
+                                const vector<size_t> *from = nullptr)
+    {
+        size_t rows = from ? from->size() : students.size();
+        switch (key)
+        {
+        case SortKey::AGE:
+        {
+            auto items = keys<uint32_t>(rows, from, pool, [&](size_t slot)
+                                        { return uint32_t(students.age(slot)) ^ 0x80000000u; });
+            radixSort(items, pool);
+            return slots(items);
+        }
+        case SortKey::CLASS_PERCENTAGE:
+        {
+            // Classes in name order, then the best percentage first
+            vector<uint16_t> rank = classRanks(students.symbolTable());
+            auto items = keys<uint64_t>(rows, from, pool, [&](size_t slot)
+                                        { return uint64_t(rank[students.symbol(slot, StudentTable::CLASS)]) << 32 |
+                                                 uint32_t(~floatKey(students.percentage(slot))); });
+            radixSort(items, pool);
+            return slots(items);
+        }
+        case SortKey::NAME:
+        {
+            auto items = keys<uint64_t>(rows, from, pool, [&](size_t slot)
+                                        { return namePrefix(students.name(slot), 0); });
+            radixSort(items, pool);
+            sortNameRuns(students, items.data(), rows, 8);
+            return slots(items);
+        }
+        default:
+        {
+            auto items = keys<uint32_t>(rows, from, pool, [&](size_t slot)
+                                        { return uint32_t(students.rollNo(slot)) ^ 0x80000000u; });
+            radixSort(items, pool);
+            return slots(items);
+        }
+        }
+    }
+};
+
+// A named roster order that is kept up to date instead of re-sorted: a treap
+// of student handles (SlotMap indices) in RosterSort::before order. Adding,
+// changing or deleting a student moves only that student, in O(log n), and
+// since handles follow their students, rows moving in the table never
+// disturb it. The caller passes the comparison, so the view stores nothing
+// but handles.
+class SortedView
+{
+    struct Node
+    {
+        uint32_t handle;
+        uint32_t priority;
+        uint32_t left, right;
+    };
+
+    static constexpr uint32_t NIL = 0; // nodes[0] is an empty sentinel
+
+    vector<Node> nodes{Node{0, 0, NIL, NIL}};
+    vector<uint32_t> unused;
+    uint32_t root = NIL;
+    uint32_t seed = 2463534242u;
+    size_t count = 0;
+
+    uint32_t nextPriority()
+    {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        return seed;
+    }
+
+    uint32_t allocate(uint32_t handle)
+    {
+        Node n{handle, nextPriority(), NIL, NIL};
+        if (unused.empty())
+        {
+            nodes.push_back(n);
+            return nodes.size() - 1;
+        }
+        uint32_t t = unused.back();
+        unused.pop_back();
+        nodes[t] = n;
+        return t;
+    }
+
+    // l receives the handles that come before `handle`, rest the others
+    template <typename Before>
+    void split(uint32_t t, uint32_t handle, uint32_t &l, uint32_t &rest, Before &before)
+    {
+        if (t == NIL)
+        {
+            l = rest = NIL;
+            return;
+        }
+        if (before(nodes[t].handle, handle))
+        {
+            split(nodes[t].right, handle, nodes[t].right, rest, before);
+            l = t;
+        }
+        else
+        {
+            split(nodes[t].left, handle, l, nodes[t].left, before);
+            rest = t;
+        }
+    }
+
+    uint32_t merge(uint32_t a, uint32_t b)
+    {
+        if (a == NIL || b == NIL)
+            return a == NIL ? b : a;
+        if (nodes[a].priority > nodes[b].priority)
+        {
+            nodes[a].right = merge(nodes[a].right, b);
+            return a;
+        }
+        nodes[b].left = merge(a, nodes[b].left);
+        return b;
+    }
+
+public:
+    size_t size() const { return count; }
+
+    // Builds the view from handles already in order, in O(n)
+    void assign(const vector<uint32_t> &sorted)
+    {
+        nodes.resize(1);
+        unused.clear();
+        vector<uint32_t> spine;
+        for (uint32_t handle : sorted)
+        {
+            uint32_t t = allocate(handle), last = NIL;
+            while (!spine.empty() && nodes[spine.back()].priority < nodes[t].priority)
+            {
+                last = spine.back();
+                spine.pop_back();
+            }
+            nodes[t].left = last;
+            if (!spine.empty())
+                nodes[spine.back()].right = t;
+            spine.push_back(t);
+        }
+        root = spine.empty() ? NIL : spine.front();
+        count = sorted.size();
+    }
+
+    // before(a, b) compares two handles and must see the inserted student's row
+    template <typename Before>
+    void insert(uint32_t handle, Before before)
+    {
+        uint32_t l, r;
+        split(root, handle, l, r, before);
+        root = merge(merge(l, allocate(handle)), r);
+        ++count;
+    }
+
+    // before must still see the row as it was when the handle was inserted
+    template <typename Before>
+    void erase(uint32_t handle, Before before)
+    {
+        uint32_t l, r;
+        split(root, handle, l, r, before);
+        // r starts with the handle itself, if it is there
+        uint32_t t = r, parent = NIL;
+        while (t != NIL && nodes[t].left != NIL)
+        {
+            parent = t;
+            t = nodes[t].left;
+        }
+        if (t != NIL && nodes[t].handle == handle)
+        {
+            if (parent == NIL)
+                r = nodes[t].right;
+            else
+                nodes[parent].left = nodes[t].right;
+            unused.push_back(t);
+            --count;
+        }
+        root = merge(l, r);
+    }
+
+    // Calls fn(handle) for every handle, in order
+    template <typename Fn>
+    void forEach(Fn fn) const
+    {
+        vector<uint32_t> path;
+        for (uint32_t t = root; t != NIL || !path.empty();)
+        {
+            if (t != NIL)
+            {
+                path.push_back(t);
+                t = nodes[t].left;
+                continue;
+            }
+            t = path.back();
+            path.pop_back();
+            fn(nodes[t].handle);
+            t = nodes[t].right;
+        }
+    }
+};
+
+// Epoch-based reclamation for readers that take no locks (RCU style). A
+// reader announces the global epoch while it reads. A writer that unlinks
+// something retires it with the epoch of the moment, and it may be freed once
+// the epoch has moved on twice: by then every reader that could have seen it
+// has finished. The epoch only moves on when every reader that is reading has
+// announced the current one. Entering and leaving cost a store and a fence,
+// and nothing a reader does waits for anybody.
+class ReadEpochs
+{
+public:
+    static constexpr size_t MAX_READERS = 1024;
+
+private:
+    struct alignas(64) Slot
+    {
+        atomic<uint64_t> epoch{0}; // 0 while not reading
+        atomic<bool> taken{false};
+    };
+
+    static Slot slots[MAX_READERS];
+    static atomic<uint64_t> global;
+
+    // Frees the thread's slot when the thread ends
+    struct Holder
+    {
+        Slot *slot = nullptr;
+        ~Holder()
+        {
+            if (slot)
+                slot->taken.store(false, memory_order_release);
+        }
+    };
+
+    // Claimed on a thread's first read; with more than MAX_READERS threads
+    // reading at once, the rest wait for a slot
+    static Slot &mySlot()
+    {
+        thread_local Holder holder;
+        while (!holder.slot)
+        {
+            for (Slot &slot : slots)
+            {
+                bool expected = false;
+                if (!slot.taken.load(memory_order_relaxed) && slot.taken.compare_exchange_strong(expected, true))
+                {
+                    holder.slot = &slot;
+                    break;
+                }
+            }
+            if (!holder.slot)
+                this_thread::yield();
+        }
+        return *holder.slot;
+    }
+
+public:
+    // Marks the calling thread as reading for as long as it exists
+    class Guard
+    {
+        Slot &slot;
+
+    public:
+        Guard() : slot(mySlot())
+        {
+            slot.epoch.store(global.load());
+            atomic_thread_fence(memory_order_seq_cst); // announced before anything is read
+        }
+        ~Guard() { slot.epoch.store(0, memory_order_release); }
+        Guard(const Guard &) = delete;
+        Guard &operator=(const Guard &) = delete;
+    };
+
+    static uint64_t current() { return global.load(); }
+
+    // Moves the epoch on if every reader has seen the current one
+    static void tryAdvance()
+    {
+        atomic_thread_fence(memory_order_seq_cst); // unlinked before the readers are checked
+        uint64_t epoch = global.load();
+        for (const Slot &slot : slots)
+        {
+            uint64_t seen = slot.epoch.load();
+            if (seen != 0 && seen != epoch)
+                return;
+        }
+        global.compare_exchange_strong(epoch, epoch + 1);
+    }
+
+    // Whether something retired in `epoch` can no longer be seen by any reader
+    static bool expired(uint64_t epoch) { return global.load() >= epoch + 2; }
+};
+
+ReadEpochs::Slot ReadEpochs::slots[ReadEpochs::MAX_READERS];
+atomic<uint64_t> ReadEpochs::global{1};
+
+// Roll number -> the latest published copy of that student, for lookups from
+// any number of threads while the roster changes. Readers take no lock and
+// never wait: they probe a shard's table and copy the version it points to.
+// A writer locks only the shard of the roll number, builds a new version and
+// publishes it with a single atomic store, so a reader sees either the whole
+// old record or the whole new one. Replaced versions, and tables replaced by a
+// rehash, are freed through ReadEpochs. Deleting leaves the roll number's
+// entry in place with no version; a rehash drops such entries.
+class RecordDirectory
+{
+    static constexpr size_t SHARDS = 64;
+    static constexpr size_t RECLAIM_BATCH = 64; // retired items per reclaim attempt
+
+    struct Version
+    {
+        Student student;
+    };
+
+    struct Entry
+    {
+        atomic<uint64_t> key{0}; // roll number | 1 << 32, or 0 if unused
+        atomic<Version *> version{nullptr};
+    };
+
+    struct Table
+    {
+        size_t mask;
+        unique_ptr<Entry[]> entries;
+        size_t keys = 0; // entries in use, with or without a version
+        size_t live = 0; // entries with a version
+
+        explicit Table(size_t capacity) : mask(capacity - 1), entries(new Entry[capacity]) {}
+    };
+
+    struct Retired
+    {
+        uint64_t epoch;
+        Version *version;
+        Table *table;
+    };
+
+    struct alignas(64) Shard
+    {
+        mutex lock; // writers only
+        atomic<Table *> table{nullptr};
+        vector<Retired> retired;
+    };
+
+    unique_ptr<Shard[]> shards{new Shard[SHARDS]};
+
+    static uint64_t keyOf(int roll) { return static_cast<uint32_t>(roll) | (uint64_t(1) << 32); }
+
+    static uint64_t hashOf(int roll) { return static_cast<uint32_t>(roll) * 0x9E3779B97F4A7C15ull; }
+
+    Shard &shardOf(int roll) const { return shards[hashOf(roll) >> 58]; }
+
+    // Entry of roll in t, or the empty entry where it would go
+    static Entry &probe(const Table &t, int roll)
+    {
+        uint64_t key = keyOf(roll);
+        size_t i = (hashOf(roll) >> 16) & t.mask;
+        while (true)
+        {
+            uint64_t seen = t.entries[i].key.load(memory_order_acquire);
+            if (seen == key || seen == 0)
+                return t.entries[i];
+            i = (i + 1) & t.mask;
+        }
+    }
+
+    void retire(Shard &shard, Version *version, Table *table)
+    {
+        shard.retired.push_back(Retired{ReadEpochs::current(), version, table});
+        if (shard.retired.size() < RECLAIM_BATCH)
+            return;
+        ReadEpochs::tryAdvance();
+        auto expired = partition(shard.retired.begin(), shard.retired.end(), [](const Retired &r)
+                                 { return !ReadEpochs::expired(r.epoch); });
+        for (auto it = expired; it != shard.retired.end(); ++it)
+        {
+            delete it->version;
+            delete it->table;
+        }
+        shard.retired.erase(expired, shard.retired.end());
+    }
+
+    // Publishes a copy of the shard's table without the deleted entries, sized
+    // for at least `live` versions
+    Table *rehash(Shard &shard, size_t live)
+    {
+        Table *old = shard.table.load(memory_order_relaxed);
+        size_t capacity = 16;
+        while (capacity * 7 < (live + 1) * 10 * 2)
+            capacity *= 2;
+        Table *grown = new Table(capacity);
+        if (old)
+        {
+            for (size_t i = 0; i <= old->mask; ++i)
+            {
+                Version *version = old->entries[i].version.load(memory_order_relaxed);
+                if (!version)
+                    continue;
+                Entry &entry = probe(*grown, version->student.rollNo);
+                entry.version.store(version, memory_order_relaxed);
+                entry.key.store(keyOf(version->student.rollNo), memory_order_relaxed);
+                ++grown->keys;
+                ++grown->live;
+            }
+        }
+        shard.table.store(grown, memory_order_release);
+        if (old)
+            retire(shard, nullptr, old);
+        return grown;
+    }
+
+public:
+    RecordDirectory() = default;
+    RecordDirectory(const RecordDirectory &) = delete;
+    RecordDirectory &operator=(const RecordDirectory &) = delete;
+
+    // Nobody may be reading any more
+    ~RecordDirectory()
+    {
+        for (size_t k = 0; k < SHARDS; ++k)
+        {
+            Shard &shard = shards[k];
+            if (Table *t = shard.table.load())
+            {
+                for (size_t i = 0; i <= t->mask; ++i)
+                    delete t->entries[i].version.load();
+                delete t;
+            }
+            for (Retired &r : shard.retired)
+            {
+                delete r.version;
+                delete r.table;
+            }
+        }
+    }
+
+    // Publishes s as the current version of its roll number
+    void put(const Student &s)
+    {
+        Shard &shard = shardOf(s.rollNo);
+        lock_guard<mutex> guard(shard.lock);
+        Table *t = shard.table.load(memory_order_relaxed);
+        if (!t)
+            t = rehash(shard, 0);
+        Entry *entry = &probe(*t, s.rollNo);
+        if (entry->key.load(memory_order_relaxed) == 0 && (t->keys + 1) * 10 > (t->mask + 1) * 7)
+        {
+            t = rehash(shard, t->live + 1);
+            entry = &probe(*t, s.rollNo);
+        }
+
+        Version *old = entry->version.load(memory_order_relaxed);
+        entry->version.store(new Version{s}, memory_order_release);
+        if (entry->key.load(memory_order_relaxed) == 0)
+        {
+            entry->key.store(keyOf(s.rollNo), memory_order_release); // after the version, for probes
+            ++t->keys;
+        }
+        if (old)
+            retire(shard, old, nullptr);
+        else
+            ++t->live;
+    }
+
+    bool erase(int roll)
+    {
+        Shard &shard = shardOf(roll);
+        lock_guard<mutex> guard(shard.lock);
+        Table *t = shard.table.load(memory_order_relaxed);
+        if (!t)
+            return false;
+        Entry &entry = probe(*t, roll);
+        Version *old = entry.version.load(memory_order_relaxed);
+        if (!old)
+            return false;
+        entry.version.store(nullptr, memory_order_release);
+        --t->live;
+        retire(shard, old, nullptr);
+        return true;
+    }
+
+    // Calls fn(student) with the current version of roll; false if there is none.
+    // Wait-free: no lock, and a bounded probe.
+    template <typename Fn>
+    bool read(int roll, Fn fn) const
+    {
+        ReadEpochs::Guard reading;
+        const Table *t = shardOf(roll).table.load(memory_order_acquire);
+        if (!t)
+            return false;
+        const Version *version = probe(*t, roll).version.load(memory_order_acquire);
+        // A probe can stop at an empty entry that another roll number is being
+        // put into: its version is stored before its key
+        if (!version || version->student.rollNo != roll)
+            return false;
+        fn(version->student);
+        return true;
+    }
+
+    bool find(int roll, Student &s) const
+    {
+        return read(roll, [&](const Student &current)
+                    { s = current; });
+    }
+};
+
+// Little helpers for binary payloads (journal records, attendance history)
+class ByteWriter
+{
+    string &bytes;
+
+public:
+    explicit ByteWriter(string &out) : bytes(out) {}
+
+    template <typename T>
+    void put(T value)
+    {
+        bytes.append(reinterpret_cast<const char *>(&value), sizeof(value));
+    }
+
+    void putString(string_view value)
+    {
+        put(static_cast<uint32_t>(value.size()));
+        bytes.append(value);
+    }
+};
+
+class ByteReader
+{
+    string_view bytes;
+    size_t pos = 0;
+
+public:
+    explicit ByteReader(string_view data) : bytes(data) {}
+
+    template <typename T>
+    bool get(T &value)
+    {
+        if (bytes.size() - pos < sizeof(value))
+            return false;
+        memcpy(&value, bytes.data() + pos, sizeof(value));
+        pos += sizeof(value);
+        return true;
+    }
+
+    bool getString(string &value)
+    {
+        uint32_t length;
+        if (!get(length) || bytes.size() - pos < length)
+            return false;
+        value.assign(bytes.data() + pos, length);
+        pos += length;
+        return true;
+    }
+
+    bool done() const { return pos == bytes.size(); }
+};
+
+// Set of 32-bit values in the style of a Roaring bitmap. Values are grouped by
+// their high 16 bits into containers of 65536; a container with at most
+// ARRAY_MAX values keeps them as a sorted uint16 array, a fuller one as a
+// 65536-bit bitmap, so a sparse set costs two bytes a value and a dense one a
+// bit. Every container knows its cardinality.
+class RoaringBitmap
+{
+public:
+    static constexpr size_t WORDS = 1024;     // 64-bit words in a bitmap container
+    static constexpr size_t ARRAY_MAX = 4096; // past this a bitmap is smaller
+
+    struct Container
+    {
+        uint16_t key = 0;
+        uint32_t cardinality = 0;
+        vector<uint16_t> values; // sorted, while an array
+        vector<uint64_t> bits;   // WORDS words, once a bitmap
+        bool isBitmap() const { return !bits.empty(); }
+    };
+
+private:
+    vector<Container> containers; // by key
+
+    size_t lowerBound(uint16_t key) const
+    {
+        return lower_bound(containers.begin(), containers.end(), key, [](const Container &c, uint16_t k)
+                           { return c.key < k; }) -
+               containers.begin();
+    }
+
+    static void toBitmap(Container &c)
+    {
+        c.bits.assign(WORDS, 0);
+        for (uint16_t v : c.values)
+            c.bits[v >> 6] |= uint64_t(1) << (v & 63);
+        vector<uint16_t>().swap(c.values);
+    }
+
+    static void toArray(Container &c)
+    {
+        c.values.clear();
+        c.values.reserve(c.cardinality);
+        forEachIn(c, [&](uint16_t v)
+                  { c.values.push_back(v); });
+        vector<uint64_t>().swap(c.bits);
+    }
+
+public:
+    // Calls fn(low 16 bits) for every value in c, in order
+    template <typename Fn>
+    static void forEachIn(const Container &c, Fn fn)
+    {
+        if (!c.isBitmap())
+        {
+            for (uint16_t v : c.values)
+                fn(v);
+            return;
+        }
+        for (size_t w = 0; w < WORDS; ++w)
+        {
+            for (uint64_t bits = c.bits[w]; bits; bits &= bits - 1)
+                fn(uint16_t(w * 64 + __builtin_ctzll(bits)));
+        }
+    }
+
+    // Adds value; false if it was already there
+    bool add(uint32_t value)
+    {
+        uint16_t key = value >> 16, low = value & 0xffff;
+        size_t i = lowerBound(key);
+        if (i == containers.size() || containers[i].key != key)
+        {
+            containers.insert(containers.begin() + i, Container());
+            containers[i].key = key;
+        }
+        Container &c = containers[i];
+        if (c.isBitmap())
+        {
+            uint64_t &word = c.bits[low >> 6], bit = uint64_t(1) << (low & 63);
+            if (word & bit)
+                return false;
+            word |= bit;
+        }
+        else
+        {
+            auto at = lower_bound(c.values.begin(), c.values.end(), low);
+            if (at != c.values.end() && *at == low)
+                return false;
+            c.values.insert(at, low);
+            if (c.values.size() > ARRAY_MAX)
+                toBitmap(c);
+        }
+        ++c.cardinality;
+        return true;
+    }
+
+    // Removes value; false if it was not there
+    bool remove(uint32_t value)
+    {
+        uint16_t key = value >> 16, low = value & 0xffff;
+        size_t i = lowerBound(key);
+        if (i == containers.size() || containers[i].key != key)
+            return false;
+        Container &c = containers[i];
+        if (c.isBitmap())
+        {
+            uint64_t &word = c.bits[low >> 6], bit = uint64_t(1) << (low & 63);
+            if (!(word & bit))
+                return false;
+            word &= ~bit;
+        }
+        else
+        {
+            auto at = lower_bound(c.values.begin(), c.values.end(), low);
+            if (at == c.values.end() || *at != low)
+                return false;
+            c.values.erase(at);
+        }
+        if (--c.cardinality == 0)
+            containers.erase(containers.begin() + i);
+        else if (c.isBitmap() && c.cardinality <= ARRAY_MAX)
+            toArray(c);
+        return true;
+    }
+
+    bool contains(uint32_t value) const
+    {
+        uint16_t key = value >> 16, low = value & 0xffff;
+        size_t i = lowerBound(key);
+        if (i == containers.size() || containers[i].key != key)
+            return false;
+        const Container &c = containers[i];
+        if (c.isBitmap())
+            return c.bits[low >> 6] >> (low & 63) & 1;
+        return binary_search(c.values.begin(), c.values.end(), low);
+    }
+
+    uint64_t cardinality() const
+    {
+        uint64_t total = 0;
+        for (const Container &c : containers)
+            total += c.cardinality;
+        return total;
+    }
+
+    bool empty() const { return containers.empty(); }
+
+    const vector<Container> &chunks() const { return containers; }
+
+    size_t memoryBytes() const
+    {
+        size_t bytes = containers.capacity() * sizeof(Container);
+        for (const Container &c : containers)
+            bytes += c.values.capacity() * sizeof(uint16_t) + c.bits.capacity() * sizeof(uint64_t);
+        return bytes;
+    }
+
+    // Container count, then per container: uint16 key, uint32 cardinality and
+    // either the array values or the bitmap words
+    void encode(ByteWriter &out) const
+    {
+        out.put(static_cast<uint32_t>(containers.size()));
+        for (const Container &c : containers)
+        {
+            out.put(c.key);
+            out.put(c.cardinality);
+            if (c.isBitmap())
+            {
+                for (uint64_t word : c.bits)
+                    out.put(word);
+            }
+            else
+            {
+                for (uint16_t v : c.values)
+                    out.put(v);
+            }
+        }
+    }
+
+    bool decode(ByteReader &in)
+    {
+        containers.clear();
+        uint32_t count;
+        if (!in.get(count) || count > 65536)
+            return false;
+        containers.resize(count);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            Container &c = containers[i];
+            if (!in.get(c.key) || !in.get(c.cardinality) || c.cardinality == 0 || c.cardinality > 65536 ||
+                (i > 0 && c.key <= containers[i - 1].key))
+                return false;
+            if (c.cardinality > ARRAY_MAX)
+            {
+                c.bits.resize(WORDS);
+                uint32_t set = 0;
+                for (uint64_t &word : c.bits)
+                {
+                    if (!in.get(word))
+                        return false;
+                    set += __builtin_popcountll(word);
+                }
+                if (set != c.cardinality)
+                    return false;
+            }
+            else
+            {
+                c.values.resize(c.cardinality);
+                for (size_t k = 0; k < c.values.size(); ++k)
+                {
+                    if (!in.get(c.values[k]) || (k > 0 && c.values[k] <= c.values[k - 1]))
+                        return false;
+                }
+            }
+        }
+        return true;
+    }
+};
+
+// Day-by-day attendance for the term. Every (class, day) register holds two
+// RoaringBitmaps of roll numbers, the students marked present and the ones
+// marked absent, so a day of a class costs a few bytes instead of a record
+// per student. The union of a day's registers is kept as well (rebuilt on
+// load, never saved), so per-student queries look at one register per day.
+// Queries read only the bitmaps: a class's absences on a day are a
+// cardinality, and the students under an attendance threshold come from
+// adding the days of a range into bit-sliced counters (one word holds one bit
+// of the counts of 64 students) and comparing 64 students at a time. Days are
+// numbered from 1970-01-01.
+class AttendanceLog
+{
+public:
+    struct Register
+    {
+        RoaringBitmap present;
+        RoaringBitmap absent;
+    };
+
+    struct Rate
+    {
+        uint32_t present = 0;
+        uint32_t marked = 0;
+    };
+
+private:
+    using Key = pair<int32_t, uint16_t>; // day, class id
+
+    vector<string> classNames;
+    map<string, uint16_t, less<>> classIds;
+    map<Key, Register> registers;
+    map<int32_t, Register> days; // every class together
+    uint64_t changeCount = 0;
+
+    // Roll numbers are kept as their 32-bit pattern
+    static uint32_t bitOf(int roll) { return static_cast<uint32_t>(roll); }
+
+    // Per-student counts for the 65536 roll numbers of one container key, as
+    // bit slices: slice b holds bit b of every count, WORDS words per slice
+    struct Counters
+    {
+        vector<uint64_t> present;
+        vector<uint64_t> marked;
+    };
+
+    static void increment(vector<uint64_t> &slices, size_t w, uint64_t carry)
+    {
+        for (size_t b = 0; carry; ++b)
+        {
+            if (b * RoaringBitmap::WORDS == slices.size())
+                slices.resize(slices.size() + RoaringBitmap::WORDS);
+            uint64_t &slice = slices[b * RoaringBitmap::WORDS + w];
+            uint64_t overflow = slice & carry;
+            slice ^= carry;
+            carry = overflow;
+        }
+    }
+
+    // Adds one to the count of every student in c
+    static void count(vector<uint64_t> &slices, const RoaringBitmap::Container &c)
+    {
+        if (c.isBitmap())
+        {
+            for (size_t w = 0; w < RoaringBitmap::WORDS; ++w)
+            {
+                if (c.bits[w])
+                    increment(slices, w, c.bits[w]);
+            }
+            return;
+        }
+        // Array values are gathered into one word at a time
+        size_t w = c.values.front() >> 6;
+        uint64_t word = 0;
+        for (uint16_t v : c.values)
+        {
+            if (v >> 6 != w)
+            {
+                increment(slices, w, word);
+                w = v >> 6;
+                word = 0;
+            }
+            word |= uint64_t(1) << (v & 63);
+        }
+        increment(slices, w, word);
+    }
+
+    // Bits w of every slice: the counts of 64 students
+    static size_t gather(const vector<uint64_t> &slices, size_t w, uint64_t *out)
+    {
+        size_t width = slices.size() / RoaringBitmap::WORDS;
+        for (size_t b = 0; b < width; ++b)
+            out[b] = slices[b * RoaringBitmap::WORDS + w];
+        return width;
+    }
+
+    // product = x * factor for 64 bit-sliced numbers; returns the product's width
+    static size_t times(const uint64_t *x, size_t width, uint32_t factor, uint64_t *product)
+    {
+        size_t out = 0;
+        for (size_t k = 0; k < 32; ++k)
+        {
+            if (!(factor >> k & 1))
+                continue;
+            // product += x << k, a ripple-carry add on whole words
+            uint64_t carry = 0;
+            size_t b = k;
+            for (; b < k + width || carry; ++b)
+            {
+                uint64_t a = b < out ? product[b] : 0, y = b - k < width ? x[b - k] : 0;
+                product[b] = a ^ y ^ carry;
+                carry = (a & y) | (carry & (a ^ y));
+            }
+            for (size_t z = out; z < k; ++z)
+                product[z] = 0;
+            out = max(out, b);
+        }
+        return out;
+    }
+
+    // Lanes where a < b, for bit-sliced numbers of widths wa and wb
+    static uint64_t lessThan(const uint64_t *a, size_t wa, const uint64_t *b, size_t wb)
+    {
+        uint64_t less = 0, equal = ~uint64_t(0);
+        for (size_t j = max(wa, wb); j-- > 0;)
+        {
+            uint64_t x = j < wa ? a[j] : 0, y = j < wb ? b[j] : 0;
+            less |= equal & ~x & y;
+            equal &= ~(x ^ y);
+        }
+        return less;
+    }
+
+    map<Key, Register>::const_iterator first(int32_t day) const { return registers.lower_bound(Key(day, 0)); }
+
+public:
+    static constexpr size_t MAX_CLASSES = 65535;
+
+    // ---- Dates ----
+
+    static int32_t dayOf(int year, unsigned month, unsigned day)
+    {
+        // Days from 1970-01-01 in the proleptic Gregorian calendar
+        year -= month <= 2;
+        int era = (year >= 0 ? year : year - 399) / 400;
+        unsigned yoe = static_cast<unsigned>(year - era * 400);
+        unsigned doy = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+        unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+        return era * 146097 + static_cast<int>(doe) - 719468;
+    }
+
+    static string formatDate(int32_t day)
+    {
+        day += 719468;
+        int era = (day >= 0 ? day : day - 146096) / 146097;
+        unsigned doe = static_cast<unsigned>(day - era * 146097);
+        unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+        unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+        unsigned mp = (5 * doy + 2) / 153;
+        unsigned d = doy - (153 * mp + 2) / 5 + 1;
+        unsigned m = mp < 10 ? mp + 3 : mp - 9;
+        int y = static_cast<int>(yoe) + era * 400 + (m <= 2);
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), "%04d-%02u-%02u", y, m, d);
+        return buffer;
+    }
+
+    static int32_t today()
+    {
+        time_t now = time(nullptr);
+        tm local;
+        localtime_r(&now, &local);
+        return dayOf(local.tm_year + 1900, local.tm_mon + 1, local.tm_mday);
+    }
+
+    // Reads YYYY-MM-DD or "today"
+    static bool parseDate(string_view text, int32_t &day)
+    {
+        if (text == "today")
+        {
+            day = today();
+            return true;
+        }
+        int year = 0, month = 0, date = 0;
+        if (text.size() != 10 || text[4] != '-' || text[7] != '-' ||
+            from_chars(text.data(), text.data() + 4, year).ptr != text.data() + 4 ||
+            from_chars(text.data() + 5, text.data() + 7, month).ptr != text.data() + 7 ||
+            from_chars(text.data() + 8, text.data() + 10, date).ptr != text.data() + 10 ||
+            month < 1 || month > 12 || date < 1 || date > 31)
+            return false;
+        day = dayOf(year, month, date);
+        return formatDate(day) == text; // rejects dates such as 2026-02-30
+    }
+
+    // ---- Changes ----
+
+    // Records roll as present or absent in its class on day, replacing any
+    // earlier mark for that day; false once there are too many classes
+    bool mark(string_view cls, int32_t day, int roll, bool present)
+    {
+        auto id = classIds.find(cls);
+        if (id == classIds.end())
+        {
+            if (classNames.size() == MAX_CLASSES)
+                return false;
+            id = classIds.emplace(string(cls), uint16_t(classNames.size())).first;
+            classNames.emplace_back(cls);
+        }
+        Register &r = registers[Key(day, id->second)];
+        Register &all = days[day];
+        uint32_t bit = bitOf(roll);
+        if ((all.present.contains(bit) || all.absent.contains(bit)) && !r.present.contains(bit) && !r.absent.contains(bit))
+        {
+            // Marked in another class earlier that day: a student keeps one mark per day
+            for (auto other = registers.lower_bound(Key(day, 0)); other != registers.end() && other->first.first == day;)
+            {
+                other->second.present.remove(bit);
+                other->second.absent.remove(bit);
+                if (&other->second != &r && other->second.present.empty() && other->second.absent.empty())
+                    other = registers.erase(other);
+                else
+                    ++other;
+            }
+        }
+        (present ? r.absent : r.present).remove(bit);
+        (present ? r.present : r.absent).add(bit);
+        (present ? all.absent : all.present).remove(bit);
+        (present ? all.present : all.absent).add(bit);
+        ++changeCount;
+        return true;
+    }
+
+    // Drops the history of a student who left, so the roll number can be reused
+    void forget(int roll)
+    {
+        for (auto d = days.begin(); d != days.end();)
+        {
+            uint32_t bit = bitOf(roll);
+            if (!d->second.present.remove(bit) && !d->second.absent.remove(bit))
+            {
+                ++d;
+                continue;
+            }
+            for (auto r = registers.lower_bound(Key(d->first, 0)); r != registers.end() && r->first.first == d->first;)
+            {
+                r->second.present.remove(bit);
+                r->second.absent.remove(bit);
+                if (r->second.present.empty() && r->second.absent.empty())
+                    r = registers.erase(r);
+                else
+                    ++r;
+            }
+            ++changeCount;
+            if (d->second.present.empty() && d->second.absent.empty())
+                d = days.erase(d);
+            else
+                ++d;
+        }
+    }
+
+    void clear()
+    {
+        classNames.clear();
+        classIds.clear();
+        registers.clear();
+        days.clear();
+        ++changeCount;
+    }
+
+    // ---- Queries ----
+
+    bool empty() const { return registers.empty(); }
+
+    // Goes up with every change; a save compares it to decide whether to write the log
+    uint64_t changes() const { return changeCount; }
+
+    // Newest day anybody was marked on, or INT32_MIN
+    int32_t lastDay() const { return registers.empty() ? INT32_MIN : registers.rbegin()->first.first; }
+
+    size_t registerCount() const { return registers.size(); }
+
+    size_t memoryBytes() const
+    {
+        size_t bytes = (registers.size() + days.size()) * (sizeof(Key) + sizeof(Register) + 32);
+        for (const auto &r : registers)
+            bytes += r.second.present.memoryBytes() + r.second.absent.memoryBytes();
+        for (const auto &d : days)
+            bytes += d.second.present.memoryBytes() + d.second.absent.memoryBytes();
+        return bytes;
+    }
+
+    // Calls fn(day, class, register) for every register from day `from` to
+    // day `to` (inclusive), by day and then by class
+    template <typename Fn>
+    void forRegisters(int32_t from, int32_t to, Fn fn) const
+    {
+        for (auto r = first(from); r != registers.end() && r->first.first <= to; ++r)
+            fn(r->first.first, string_view(classNames[r->first.second]), r->second);
+    }
+
+    // Days a student was marked, and marked present, in [from, to]
+    Rate rateOf(int roll, int32_t from, int32_t to) const
+    {
+        Rate rate;
+        for (auto r = days.lower_bound(from); r != days.end() && r->first <= to; ++r)
+        {
+            if (r->second.present.contains(bitOf(roll)))
+            {
+                ++rate.present;
+                ++rate.marked;
+            }
+            else if (r->second.absent.contains(bitOf(roll)))
+            {
+                ++rate.marked;
+            }
+        }
+        return rate;
+    }
+
+    // Students marked at least once in [from, to] who were present on fewer
+    // than percent% of the days they were marked, in roll number order
+    // (ordered by the 32-bit pattern, so negative roll numbers come last)
+    vector<int> below(int32_t from, int32_t to, uint32_t percent) const
+    {
+        map<uint16_t, Counters> counters;
+        for (auto r = days.lower_bound(from); r != days.end() && r->first <= to; ++r)
+        {
+            for (const auto &c : r->second.present.chunks())
+            {
+                Counters &k = counters[c.key];
+                count(k.present, c);
+                count(k.marked, c);
+            }
+            for (const auto &c : r->second.absent.chunks())
+                count(counters[c.key].marked, c);
+        }
+
+        // 100 * present < percent * marked, for 64 students per step
+        vector<int> rolls;
+        uint64_t p[64], m[64], hundredP[64], percentM[64];
+        for (const auto &k : counters)
+        {
+            for (size_t w = 0; w < RoaringBitmap::WORDS; ++w)
+            {
+                size_t wm = gather(k.second.marked, w, m);
+                uint64_t anyMarked = 0;
+                for (size_t b = 0; b < wm; ++b)
+                    anyMarked |= m[b];
+                if (!anyMarked)
+                    continue;
+                size_t wp = gather(k.second.present, w, p);
+                size_t wa = times(p, wp, 100, hundredP);
+                size_t wb = times(m, wm, percent, percentM);
+                uint64_t hits = lessThan(hundredP, wa, percentM, wb) & anyMarked;
+                for (; hits; hits &= hits - 1)
+                    rolls.push_back(static_cast<int>(uint32_t(k.first) << 16 | (w * 64 + __builtin_ctzll(hits))));
+            }
+        }
+        return rolls;
+    }
+
+    // ---- Persistence ----
+
+    // Class names, then every register: int32 day, uint16 class id and the
+    // present and absent bitmaps
+    void encode(string &bytes) const
+    {
+        ByteWriter out(bytes);
+        out.put(static_cast<uint32_t>(classNames.size()));
+        for (const string &name : classNames)
+            out.putString(name);
+        out.put(static_cast<uint64_t>(registers.size()));
+        for (const auto &r : registers)
+        {
+            out.put(r.first.first);
+            out.put(r.first.second);
+            r.second.present.encode(out);
+            r.second.absent.encode(out);
+        }
+    }
+
+    bool decode(string_view bytes)
+    {
+        clear();
+        ByteReader in(bytes);
+        uint32_t names;
+        if (!in.get(names) || names > MAX_CLASSES)
+            return false;
+        string name;
+        for (uint32_t id = 0; id < names; ++id)
+        {
+            if (!in.getString(name) || !classIds.emplace(name, uint16_t(id)).second)
+                return false;
+            classNames.push_back(name);
+        }
+        uint64_t count;
+        if (!in.get(count))
+            return false;
+        Key last(INT32_MIN, 0);
+        for (uint64_t i = 0; i < count; ++i)
+        {
+            Key key;
+            Register r;
+            if (!in.get(key.first) || !in.get(key.second) || key.second >= names ||
+                (i > 0 && key <= last) || !r.present.decode(in) || !r.absent.decode(in))
+                return false;
+            Register &all = days[key.first];
+            for (const RoaringBitmap *from : {&r.present, &r.absent})
+            {
+                for (const auto &c : from->chunks())
+                {
+                    RoaringBitmap &to = from == &r.present ? all.present : all.absent;
+                    RoaringBitmap::forEachIn(c, [&](uint16_t low)
+                                             { to.add(uint32_t(c.key) << 16 | low); });
+                }
+            }
+            registers.emplace_hint(registers.end(), key, move(r));
+            last = key;
+        }
+        changeCount = 0;
+        return in.done();
+    }
+};
+
+// ==================== Interfaces ====================
+
+// A grading ladder: the grade is letter[k] when the percentage reaches exactly
+// k of the cutoffs (listed in ascending order)
+struct GradeCutoffs
+{
+    static constexpr size_t MAX_CUTOFFS = 8;
+    size_t count = 0;
+    float minimum[MAX_CUTOFFS] = {};
+    char letter[MAX_CUTOFFS + 1] = {};
+
+    // Branchless: adds up the cutoffs reached instead of testing them in turn
+    constexpr char gradeOf(float percentage) const
+    {
+        size_t reached = 0;
+        for (size_t c = 0; c < count; ++c)
+            reached += percentage >= minimum[c];
+        return letter[reached];
+    }
+
+    // Whole-number cutoffs within (0, 100] can be served from a table indexed
+    // by the integer part of the percentage
+    constexpr bool wholePercents() const
+    {
+        for (size_t c = 0; c < count; ++c)
+        {
+            if (minimum[c] <= 0 || minimum[c] > 100 || minimum[c] != static_cast<int>(minimum[c]))
+                return false;
+        }
+        return true;
+    }
+};
+
+// Grade for each whole percentage 0..100, generated from a ladder at compile time
+struct GradeBuckets
+{
+    char letter[101] = {};
+
+    constexpr explicit GradeBuckets(const GradeCutoffs &ladder)
+    {
+        for (int p = 0; p <= 100; ++p)
+            letter[p] = ladder.gradeOf(p);
+    }
+
+    // Below 1 (or NaN) is bucket 0 and above 100 is bucket 100
+    char lookup(float percentage) const
+    {
+        return letter[percentage >= 1 ? static_cast<int>(min(percentage, 100.0f)) : 0];
+    }
+};
+
+// Interface for Grade Strategy (LSP: Base class)
+class IGradeStrategy
+{
+public:
+    virtual char calculateGrade(float percentage) const = 0;
+    // Strategies that are a plain ladder of cutoffs can describe it, which lets
+    // whole columns be graded with vector compares instead of a call per student
+    virtual bool describeCutoffs(GradeCutoffs &) const { return false; }
+    virtual ~IGradeStrategy() = default;
+};
+
+// Interface for Exporters (LSP: Base class)
+class IExporter
+{
+public:
+    // order lists the slots to write, in order (any subset of the table);
+    // empty writes the whole table as stored
+    virtual void exportData(const StudentTable &students, const vector<uint32_t> &order,
+                            const string &filename) const = 0;
+    virtual ~IExporter() = default;
+};
+
+// Interface for Report Generators (LSP: Base class)
+class IReportGenerator
+{
+public:
+    virtual void generateReport(const StudentTable &students, const ClassIndex &classes) const = 0;
+    // The report of one class, without prompting; slots are its rows in students, in any order
+    virtual void writeReport(const StudentTable &students, vector<uint32_t> slots, string_view cls,
+                             ostream &out) const = 0;
+    virtual ~IReportGenerator() = default;
+};
+
+// Interface for GradeCalculator
+class IGradeCalculator
+{
+public:
+    virtual void calculateGrade(Student &s) const = 0;
+    // Percentages and grades for a run of rows given as mark columns
+    virtual void gradeColumns(const float *const marks[5], float *percentage, char *grade, size_t rows) const = 0;
+    // Grade for a percentage that did not come from marks (e.g. an imported CSV)
+    virtual char gradeFor(float percentage) const = 0;
+    // Identifies the grading policy, so stored grades can be reused when it has not changed
+    virtual uint64_t fingerprint() const = 0;
+    virtual ~IGradeCalculator() = default;
+
+    // Like calculateGrade, but a student without marks keeps its percentage
+    // and is only given the grade for it
+    void gradeStudent(Student &s) const
+    {
+        if (hasMarks(s.marks))
+            calculateGrade(s);
+        else
+            s.grade = gradeFor(s.percentage);
+    }
+
+    // Like gradeColumns, with `percentage` holding the current percentages on
+    // entry so that rows without marks keep theirs
+    void gradeRows(const float *const marks[5], float *percentage, char *grade, size_t rows) const
+    {
+        float current[StudentTable::SEGMENT_ROWS];
+        copy_n(percentage, rows, current);
+        gradeColumns(marks, percentage, grade, rows);
+        for (size_t i = 0; i < rows; ++i)
+        {
+            // Only a row whose marks sum to nothing can be one without marks
+            if (percentage[i] == 0 && current[i] != 0)
+            {
+                float row[5] = {marks[0][i], marks[1][i], marks[2][i], marks[3][i], marks[4][i]};
+                if (!hasMarks(row))
+                {
+                    percentage[i] = current[i];
+                    grade[i] = gradeFor(current[i]);
+                }
+            }
+        }
+    }
+
+    // Recomputes the percentage and grade of every student in the table
+    void gradeTable(StudentTable &students) const
+    {
+        students.updateGrades([this](const float *const marks[5], float *percentage, char *grade, size_t rows)
+                              { gradeRows(marks, percentage, grade, rows); });
+    }
+};
+
+// ==================== Concrete Implementations ====================
+
+// Default Grading Strategy (LSP: Substitutable for IGradeStrategy). The
+// ladder is a constexpr table; being final, calls on the concrete type (as in
+// StaticGradeCalculator) are resolved at compile time and inlined.
+class DefaultGradeStrategy final : public IGradeStrategy
+{
+public:
+    static constexpr GradeCutoffs ladder{4, {60, 70, 80, 90}, {'F', 'D', 'C', 'B', 'A'}};
+    static constexpr GradeBuckets buckets{ladder};
+    static_assert(ladder.wholePercents(), "bucket table needs whole-percent cutoffs");
+
+    char calculateGrade(float percentage) const override
+    {
+        return buckets.lookup(percentage);
+    }
+
+    bool describeCutoffs(GradeCutoffs &cutoffs) const override
+    {
+        cutoffs = ladder;
+        return true;
+    }
+};
+
+// Strict Grading Strategy (LSP: Another substitutable implementation)
+class StrictGradeStrategy final : public IGradeStrategy
+{
+public:
+    static constexpr GradeCutoffs ladder{4, {65, 75, 85, 95}, {'F', 'D', 'C', 'B', 'A'}};
+    static constexpr GradeBuckets buckets{ladder};
+    static_assert(ladder.wholePercents(), "bucket table needs whole-percent cutoffs");
+
+    char calculateGrade(float percentage) const override
+    {
+        return buckets.lookup(percentage);
+    }
+
+    bool describeCutoffs(GradeCutoffs &cutoffs) const override
+    {
+        cutoffs = ladder;
+        return true;
+    }
+};
+
+// CSV Exporter (LSP: Substitutable for IExporter). Rows are formatted
+// with to_chars into one buffer per block of the roster; blocks are formatted
+// on the pool and written to the file in order, one write() per block.
+class CSVExporter : public IExporter
+{
+    shared_ptr<ThreadPool> pool;
+
+    static constexpr size_t BLOCK_ROWS = 32768;
+
+    template <typename T>
+    static void putNumber(string &out, T value)
+    {
+        char digits[32];
+        auto result = to_chars(digits, digits + sizeof(digits), value);
+        out.append(digits, result.ptr);
+    }
+
+    // Quotes a field only when it needs it, so the importer reads it back unchanged
+    static void putField(string &out, string_view text)
+    {
+        if (text.find_first_of(",\"\r\n") == string_view::npos)
+        {
+            out.append(text);
+            return;
+        }
+        out += '"';
+        for (char c : text)
+        {
+            if (c == '"')
+                out += '"';
+            out += c;
+        }
+        out += '"';
+    }
+
+    // `symbols` holds the formatted field for every symbol id; rows [from, to)
+    // of order are written, or of the table itself when order is empty
+    static void formatRows(const StudentTable &students, const vector<string> &symbols,
+                           const vector<uint32_t> &order, size_t from, size_t to, string &out)
+    {
+        out.clear();
+        out.reserve((to - from) * 64);
+        for (size_t k = from; k < to; ++k)
+        {
+            size_t i = order.empty() ? k : order[k];
+            putNumber(out, students.rollNo(i));
+            out += ',';
+            putField(out, students.name(i));
+            out += ',';
+            out += symbols[students.symbol(i, StudentTable::CLASS)];
+            out += ',';
+            putNumber(out, students.age(i));
+            out += ',';
+            out += symbols[students.symbol(i, StudentTable::GENDER)];
+            out += ',';
+            putNumber(out, students.percentage(i));
+            out += ',';
+            out += students.grade(i);
+            out += ',';
+            out += symbols[students.symbol(i, StudentTable::ATTENDANCE)];
+            out += '\n';
+        }
+    }
+
+    static bool writeAll(int fd, const string &block)
+    {
+        const char *p = block.data();
+        size_t left = block.size();
+        while (left)
+        {
+            ssize_t n = ::write(fd, p, left);
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                return false;
+            }
+            p += n;
+            left -= n;
+        }
+        return true;
+    }
+
+public:
+    explicit CSVExporter(shared_ptr<ThreadPool> workers) : pool(move(workers)) {}
+
+    void exportData(const StudentTable &students, const vector<uint32_t> &order,
+                    const string &filename) const override
+    {
+        auto start = chrono::steady_clock::now();
+        int fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0)
+        {
+            cout << "Failed to open file: " << filename << "\n";
+            return;
+        }
+
+        // Class, gender and attendance are formatted once per distinct value
+        vector<string> symbols(students.symbolTable().size());
+        for (size_t id = 0; id < symbols.size(); ++id)
+            putField(symbols[id], students.symbolTable().name(id));
+
+        bool ok = writeAll(fd, "Roll,Name,Class,Age,Gender,Percentage,Grade,Attendance\n");
+        uint64_t bytes = 0;
+        size_t rows = order.empty() ? students.size() : order.size();
+        size_t blocks = (rows + BLOCK_ROWS - 1) / BLOCK_ROWS;
+        auto submit = [&](size_t b)
+        {
+            return pool->submit([&students, &symbols, &order, rows, b]
+                                {
+                                    string out;
+                                    formatRows(students, symbols, order, b * BLOCK_ROWS,
+                                               min(rows, (b + 1) * BLOCK_ROWS), out);
+                                    return out; });
+        };
+
+        // A bounded window of blocks in flight; every block is waited for even
+        // after a failed write, since the tasks reference the roster
+        deque<future<string>> inFlight;
+        size_t next = 0, window = 2 * pool->size();
+        while (next < blocks && inFlight.size() < window)
+            inFlight.push_back(submit(next++));
+        while (!inFlight.empty())
+        {
+            string block = inFlight.front().get();
+            inFlight.pop_front();
+            if (next < blocks && ok)
+                inFlight.push_back(submit(next++));
+            ok = ok && writeAll(fd, block);
+            bytes += block.size();
+        }
+        ok = ::close(fd) == 0 && ok;
+
+        if (!ok)
+        {
+            cout << "Failed to write file: " << filename << "\n";
+            return;
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        cout << "Data exported to " << filename << ": " << rows << " students in "
+             << fixed << setprecision(2) << seconds << " s (" << setprecision(1)
+             << bytes / max(seconds, 1e-9) / (1 << 20) << " MB/s)\n";
+    }
+};
+
+// Text Report Generator (LSP: Substitutable for IReportGenerator)
+class TextReportGenerator : public IReportGenerator
+{
+public:
+    void generateReport(const StudentTable &students, const ClassIndex &classes) const override
+    {
+        string cls;
+        cout << "Enter class to view report: ";
+        cin >> cls;
+        writeReport(students, classes.slotsOf(cls), cls, cout);
+    }
+
+    void writeReport(const StudentTable &students, vector<uint32_t> slots, string_view cls,
+                     ostream &out) const override
+    {
+        // Only this class's rows, listed in roster order
+        sort(slots.begin(), slots.end());
+        for (uint32_t i : slots)
+        {
+            out << students.rollNo(i) << "\t" << students.name(i) << "\t" << students.grade(i) << "\t"
+                << students.percentage(i) << "%\n";
+        }
+        if (slots.empty())
+        {
+            out << "No students found in class " << cls << "\n";
+        }
+    }
+};
+
+// ==================== Core Management Classes ====================
+
+// Column kernels shared by the grade calculators
+struct GradeKernels
+{
+    // percentage[i] = (marks[0][i] + ... + marks[4][i]) / 5, summed in the same
+    // order as calculateGrade so both paths give bit-identical results
+    static void sumMarks(const float *const marks[5], float *percentage, size_t rows)
+    {
+        size_t i = 0;
+#if defined(__AVX2__)
+        const __m256 five = _mm256_set1_ps(5);
+        for (; i + 8 <= rows; i += 8)
+        {
+            __m256 total = _mm256_setzero_ps();
+            for (int m = 0; m < 5; ++m)
+                total = _mm256_add_ps(total, _mm256_loadu_ps(marks[m] + i));
+            _mm256_storeu_ps(percentage + i, _mm256_div_ps(total, five));
+        }
+#elif defined(__SSE2__)
+        const __m128 five = _mm_set1_ps(5);
+        for (; i + 4 <= rows; i += 4)
+        {
+            __m128 total = _mm_setzero_ps();
+            for (int m = 0; m < 5; ++m)
+                total = _mm_add_ps(total, _mm_loadu_ps(marks[m] + i));
+            _mm_storeu_ps(percentage + i, _mm_div_ps(total, five));
+        }
+#endif
+        for (; i < rows; ++i)
+        {
+            float total = 0;
+            for (int m = 0; m < 5; ++m)
+                total += marks[m][i];
+            percentage[i] = total / 5;
+        }
+    }
+
+    // Counts the cutoffs each percentage reaches and looks the letter up
+    static void gradeByCutoffs(const GradeCutoffs &cutoffs, const float *percentage, char *grade, size_t rows)
+    {
+        size_t i = 0;
+        int32_t level[8];
+#if defined(__AVX2__)
+        const __m256 one = _mm256_set1_ps(1);
+        for (; i + 8 <= rows; i += 8)
+        {
+            __m256 p = _mm256_loadu_ps(percentage + i), reached = _mm256_setzero_ps();
+            for (size_t c = 0; c < cutoffs.count; ++c)
+                reached = _mm256_add_ps(reached, _mm256_and_ps(_mm256_cmp_ps(p, _mm256_set1_ps(cutoffs.minimum[c]), _CMP_GE_OQ), one));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(level), _mm256_cvttps_epi32(reached));
+            for (int k = 0; k < 8; ++k)
+                grade[i + k] = cutoffs.letter[level[k]];
+        }
+#elif defined(__SSE2__)
+        const __m128 one = _mm_set1_ps(1);
+        for (; i + 4 <= rows; i += 4)
+        {
+            __m128 p = _mm_loadu_ps(percentage + i), reached = _mm_setzero_ps();
+            for (size_t c = 0; c < cutoffs.count; ++c)
+                reached = _mm_add_ps(reached, _mm_and_ps(_mm_cmpge_ps(p, _mm_set1_ps(cutoffs.minimum[c])), one));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(level), _mm_cvttps_epi32(reached));
+            for (int k = 0; k < 4; ++k)
+                grade[i + k] = cutoffs.letter[level[k]];
+        }
+#endif
+        for (; i < rows; ++i)
+        {
+            size_t reached = 0;
+            for (size_t c = 0; c < cutoffs.count; ++c)
+                reached += percentage[i] >= cutoffs.minimum[c];
+            grade[i] = cutoffs.letter[reached];
+        }
+    }
+
+    // FNV-1a over the grade at every 0.01% step
+    template <typename GradeFn>
+    static uint64_t fingerprint(GradeFn gradeFor)
+    {
+        uint64_t hash = 14695981039346656037ull;
+        for (int step = 0; step <= 10000; ++step)
+        {
+            hash ^= static_cast<unsigned char>(gradeFor(step / 100.0f));
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+};
+
+class GradeCalculator : public IGradeCalculator
+{
+    shared_ptr<IGradeStrategy> strategy;
+
+public:
+    explicit GradeCalculator(shared_ptr<IGradeStrategy> strat) : strategy(move(strat)) {}
+
+    void calculateGrade(Student &s) const override
+    {
+        float total = 0;
+        for (float mark : s.marks)
+            total += mark;
+        s.percentage = total / 5;
+        s.grade = strategy->calculateGrade(s.percentage);
+    }
+
+    // Vector kernels for the percentages and, if the strategy is a cutoff
+    // ladder, for the grades too
+    void gradeColumns(const float *const marks[5], float *percentage, char *grade, size_t rows) const override
+    {
+        GradeKernels::sumMarks(marks, percentage, rows);
+        GradeCutoffs cutoffs;
+        if (strategy->describeCutoffs(cutoffs) && cutoffs.count <= GradeCutoffs::MAX_CUTOFFS)
+        {
+            GradeKernels::gradeByCutoffs(cutoffs, percentage, grade, rows);
+        }
+        else
+        {
+            for (size_t i = 0; i < rows; ++i)
+                grade[i] = strategy->calculateGrade(percentage[i]);
+        }
+    }
+
+    char gradeFor(float percentage) const override
+    {
+        return strategy->calculateGrade(percentage);
+    }
+
+    uint64_t fingerprint() const override
+    {
+        return GradeKernels::fingerprint([this](float percentage)
+                                         { return strategy->calculateGrade(percentage); });
+    }
+};
+
+// Same calculator with the strategy fixed at compile time: the strategy is a
+// member of a final class, so its calls are direct and the hot loops inline
+// them. GradeCalculator stays the general path for strategies chosen at run time.
+template <typename Strategy>
+class StaticGradeCalculator : public IGradeCalculator
+{
+    Strategy strategy;
+
+public:
+    void calculateGrade(Student &s) const override
+    {
+        float total = 0;
+        for (float mark : s.marks)
+            total += mark;
+        s.percentage = total / 5;
+        s.grade = strategy.calculateGrade(s.percentage);
+    }
+
+    void gradeColumns(const float *const marks[5], float *percentage, char *grade, size_t rows) const override
+    {
+        GradeKernels::sumMarks(marks, percentage, rows);
+        for (size_t i = 0; i < rows; ++i)
+            grade[i] = strategy.calculateGrade(percentage[i]);
+    }
+
+    char gradeFor(float percentage) const override
+    {
+        return strategy.calculateGrade(percentage);
+    }
+
+    uint64_t fingerprint() const override
+    {
+        return GradeKernels::fingerprint([this](float percentage)
+                                         { return strategy.calculateGrade(percentage); });
+    }
+};
+
+// Grading policies that can be switched to at run time
+struct GradingPolicy
+{
+    string name;
+    shared_ptr<IGradeCalculator> calculator;
+    shared_ptr<IGradeStrategy> strategy; // the same policy, for what-if comparisons
+};
+
+vector<GradingPolicy> gradingPolicies()
+{
+    return {{"default", make_shared<StaticGradeCalculator<DefaultGradeStrategy>>(), make_shared<DefaultGradeStrategy>()},
+            {"strict", make_shared<StaticGradeCalculator<StrictGradeStrategy>>(), make_shared<StrictGradeStrategy>()}};
+}
+
+class FileHandler
+{
+public:
+    // order lists the slots to write, in order (any subset of the table);
+    // empty writes the whole table as stored
+    static void saveToFile(const StudentTable &students, const string &filename = "students.txt",
+                           const vector<uint32_t> &order = {})
+    {
+        ofstream file(filename);
+        size_t rows = order.empty() ? students.size() : order.size();
+        for (size_t k = 0; k < rows; ++k)
+        {
+            StudentView s = students.view(order.empty() ? k : order[k]);
+            file << s.name << " " << s.rollNo << " " << s.studentClass << " "
+                 << s.age << " " << s.gender;
+            for (float mark : s.marks)
+                file << " " << mark;
+            file << " " << s.attendance << "\n";
+        }
+    }
+
+    // Calls onRecord(s) for every record of a students.txt-style file: eleven
+    // whitespace-separated fields per record, stopping at the first one that
+    // does not parse. The file is mapped and numbers are parsed with
+    // from_chars (stream extraction of a float allocates), and one Student is
+    // reused throughout, so reading allocates nothing per record.
+    template <typename RecordFn>
+    static void loadFromFile(const string &filename, RecordFn onRecord)
+    {
+        MappedFile file;
+        if (!file.open(filename))
+            return;
+        const char *p = file.data(), *end = p + file.size();
+        auto token = [&p, end]
+        {
+            while (p < end && isspace(static_cast<unsigned char>(*p)))
+                ++p;
+            const char *start = p;
+            while (p < end && !isspace(static_cast<unsigned char>(*p)))
+                ++p;
+            return string_view(start, p - start);
+        };
+        auto number = [](string_view text, auto &value)
+        {
+            if (!text.empty() && text[0] == '+')
+                text.remove_prefix(1);
+            auto result = from_chars(text.data(), text.data() + text.size(), value);
+            return !text.empty() && result.ec == errc() && result.ptr == text.data() + text.size();
+        };
+
+        Student s;
+        string_view field[11];
+        while (true)
+        {
+            for (auto &f : field)
+                f = token();
+            bool ok = !field[10].empty() && number(field[1], s.rollNo) && number(field[3], s.age);
+            for (int m = 0; ok && m < 5; ++m)
+                ok = number(field[5 + m], s.marks[m]);
+            if (!ok)
+                break;
+            s.name.assign(field[0]);
+            s.studentClass.assign(field[2]);
+            s.gender.assign(field[4]);
+            s.attendance.assign(field[10]);
+            onRecord(s);
+        }
+    }
+
+    // Upper bound on the text of the records in a file: the file size
+    static size_t textBytes(const string &filename)
+    {
+        struct stat st;
+        return stat(filename.c_str(), &st) == 0 ? st.st_size : 0;
+    }
+
+    // ---- Binary snapshot (students.dat) ----
+    //
+    // Layout, all little-endian, every chunk 8-byte aligned:
+    //   header slot 0 | header slot 1 | chunks...
+    // A header names a chunk directory: one entry per row segment (1024 students)
+    // followed by one entry per page of the roll-number index; the header also
+    // points at the symbol chunk holding the interned class, gender and
+    // attendance values, and at the attendance history chunk. A save appends
+    // fresh copies of only the chunks that changed plus a new directory, syncs,
+    // and then overwrites the older of the two header slots with the next
+    // generation. Chunks that a valid header points at are never overwritten, so
+    // a crash during a save leaves the previous generation readable. Once stale
+    // chunks make up more than half of the file, the next save rewrites it whole.
+    //
+    // Segment chunk:
+    //   SegmentHeader | rollNo int32[r] | age int32[r] | marks float[r] x5
+    //   percentage float[r] | grade char[r]
+    //   name: uint32[r] offsets into the string heap
+    //   class, gender, attendance: uint16[r] symbol ids
+    //   string heap: uint32 length followed by the bytes, repeated
+    // Symbol chunk: the values of symbols 1..symbolCount-1 in id order, each a
+    // uint32 length followed by the bytes (symbol 0 is the empty string). It is
+    // append-only like the table, so a save writes it again only when it grew.
+    // Index page chunk: RollIndex entries, PAGE_ENTRIES per page, used in place.
+    // Attendance chunk: AttendanceLog::encode(); written again whenever the
+    // history changed, absent (zero bytes) while there is none.
+
+    enum SegmentColumn
+    {
+        COL_ROLL,
+        COL_AGE,
+        COL_MARKS,
+        COL_PERCENTAGE = COL_MARKS + 5,
+        COL_GRADE,
+        COL_NAME,
+        COL_CLASS,
+        COL_GENDER,
+        COL_ATTENDANCE,
+        COL_HEAP,
+        COL_COUNT
+    };
+
+    struct SegmentHeader
+    {
+        uint32_t rows;
+        uint32_t columnCount;
+        uint64_t columnOffset[COL_COUNT]; // from the start of the chunk
+        uint64_t columnBytes[COL_COUNT];
+    };
+
+    struct ChunkRef
+    {
+        uint64_t offset;
+        uint64_t bytes;
+    };
+
+    struct SnapshotHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t checksum; // FNV-1a of the header with this field zeroed
+        uint64_t generation;
+        uint64_t rowCount;
+        uint64_t segmentCount;
+        uint64_t indexCount;         // entries in the roll-number index
+        uint64_t indexCapacity;      // size of the index hash table
+        uint64_t gradingFingerprint; // IGradeCalculator::fingerprint() the grades were computed with
+        uint64_t journalSequence;    // last journal record folded into this snapshot
+        uint64_t directoryOffset;
+        uint64_t fileBytes; // end of the data this generation wrote
+        uint64_t liveBytes; // bytes of the chunks this generation uses
+        uint64_t symbolCount;
+        ChunkRef symbols;
+        uint64_t listOrder; // SortKey the roster is listed in; COUNT for storage order
+        ChunkRef attendance;
+    };
+
+    static constexpr char SNAPSHOT_MAGIC[8] = {'S', 'M', 'S', 'S', 'N', 'A', 'P', '\0'};
+    static constexpr uint32_t SNAPSHOT_VERSION = 7;
+    static constexpr uint64_t HEADER_SLOT = 4096;
+
+    // Header fields that describe the state a snapshot was taken in
+    struct SnapshotMeta
+    {
+        uint64_t gradingFingerprint = 0;
+        uint64_t journalSequence = 0;
+        SortKey listOrder = SortKey::COUNT;
+        AttendanceLog *attendance = nullptr; // history saved with the roster, or loaded into; none if null
+    };
+
+    // Where the chunks of the current roster live in the snapshot it was loaded
+    // from or last saved to; lets the next save reuse every unchanged chunk
+    struct SnapshotLayout
+    {
+        string filename;
+        uint64_t generation = 0;
+        uint64_t fileBytes = 0;
+        uint64_t liveBytes = 0;
+        uint64_t indexCapacity = 0;
+        uint64_t symbolCount = 0;
+        ChunkRef symbols = {};
+        uint64_t attendanceChanges = 0; // AttendanceLog::changes() when the chunk was written
+        ChunkRef attendance = {};
+        vector<ChunkRef> segments;
+        vector<ChunkRef> indexPages;
+    };
+
+    struct SaveStats
+    {
+        uint64_t bytesWritten = 0;
+        size_t changedRows = 0;
+        size_t segmentsWritten = 0;
+        size_t segments = 0;
+        size_t indexPagesWritten = 0;
+        bool rewritten = false; // the whole file was written out again
+    };
+
+    static bool isSnapshot(const string &filename)
+    {
+        ifstream file(filename, ios::binary);
+        char magic[8] = {};
+        return file.read(magic, sizeof(magic)) && equal(magic, magic + 8, SNAPSHOT_MAGIC);
+    }
+
+private:
+    static uint64_t align8(uint64_t offset) { return (offset + 7) & ~uint64_t(7); }
+
+    static uint32_t headerChecksum(SnapshotHeader header)
+    {
+        header.checksum = 0;
+        const unsigned char *bytes = reinterpret_cast<const unsigned char *>(&header);
+        uint32_t hash = 2166136261u;
+        for (size_t i = 0; i < sizeof(header); ++i)
+        {
+            hash ^= bytes[i];
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+
+    static bool writeAt(int fd, uint64_t offset, const void *data, size_t length)
+    {
+        const char *bytes = static_cast<const char *>(data);
+        while (length > 0)
+        {
+            ssize_t n = pwrite(fd, bytes, length, offset);
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                return false;
+            }
+            bytes += n;
+            offset += n;
+            length -= n;
+        }
+        return true;
+    }
+
+    // Bytes per row of a fixed-width segment column
+    static uint64_t columnWidth(int column)
+    {
+        if (column == COL_GRADE)
+            return 1;
+        return column >= COL_CLASS && column <= COL_ATTENDANCE ? 2 : 4;
+    }
+
+    // Appends a length-prefixed string to a heap and returns its offset
+    static uint32_t putString(vector<char> &heap, string_view value)
+    {
+        uint32_t offset = static_cast<uint32_t>(heap.size());
+        uint32_t length = static_cast<uint32_t>(value.size());
+        heap.insert(heap.end(), reinterpret_cast<const char *>(&length),
+                    reinterpret_cast<const char *>(&length) + sizeof(length));
+        heap.insert(heap.end(), value.begin(), value.end());
+        return offset;
+    }
+
+    static vector<char> encodeSymbols(const SymbolTable &symbols)
+    {
+        vector<char> chunk;
+        for (size_t id = 1; id < symbols.size(); ++id)
+            putString(chunk, symbols.name(id));
+        return chunk;
+    }
+
+    // Writes the symbol chunk at the end of the file
+    static bool writeSymbols(int fd, const SymbolTable &symbols, uint64_t &end, ChunkRef &ref)
+    {
+        vector<char> chunk = encodeSymbols(symbols);
+        end = align8(end);
+        ref = ChunkRef{end, chunk.size()};
+        end += chunk.size();
+        return writeAt(fd, ref.offset, chunk.data(), chunk.size());
+    }
+
+    // Writes the attendance chunk at the end of the file; nothing for an empty history
+    static bool writeAttendance(int fd, const AttendanceLog *history, uint64_t &end, ChunkRef &ref)
+    {
+        ref = ChunkRef{};
+        if (!history || history->empty())
+            return true;
+        string chunk;
+        history->encode(chunk);
+        end = align8(end);
+        ref = ChunkRef{end, chunk.size()};
+        end += chunk.size();
+        return writeAt(fd, ref.offset, chunk.data(), chunk.size());
+    }
+
+    // Serializes one row segment of the table into a chunk
+    static string encodeSegment(const StudentTable &students, size_t segment)
+    {
+        size_t first = segment * StudentTable::SEGMENT_ROWS;
+        size_t rows = min(StudentTable::SEGMENT_ROWS, students.size() - first);
+        vector<char> heap;
+
+        SegmentHeader header = {};
+        header.rows = static_cast<uint32_t>(rows);
+        header.columnCount = COL_COUNT;
+        uint64_t offset = sizeof(header);
+        for (int c = 0; c < COL_COUNT; ++c)
+        {
+            if (c == COL_HEAP)
+                break;
+            header.columnBytes[c] = rows * columnWidth(c);
+            offset = align8(offset);
+            header.columnOffset[c] = offset;
+            offset += header.columnBytes[c];
+        }
+
+        string chunk(offset, '\0');
+        auto column = [&chunk, &header](int c)
+        { return &chunk[header.columnOffset[c]]; };
+        for (size_t i = 0; i < rows; ++i)
+        {
+            StudentView s = students.view(first + i);
+            int32_t roll = s.rollNo, age = s.age;
+            uint32_t name = putString(heap, s.name);
+            memcpy(column(COL_ROLL) + i * 4, &roll, 4);
+            memcpy(column(COL_AGE) + i * 4, &age, 4);
+            for (int m = 0; m < 5; ++m)
+                memcpy(column(COL_MARKS + m) + i * 4, &s.marks[m], 4);
+            memcpy(column(COL_PERCENTAGE) + i * 4, &s.percentage, 4);
+            column(COL_GRADE)[i] = s.grade;
+            memcpy(column(COL_NAME) + i * 4, &name, 4);
+            for (int f = 0; f < StudentTable::SYMBOL_FIELDS; ++f)
+            {
+                uint16_t id = students.symbol(first + i, StudentTable::TextField(StudentTable::CLASS + f));
+                memcpy(column(COL_CLASS + f) + i * 2, &id, 2);
+            }
+        }
+
+        header.columnOffset[COL_HEAP] = align8(chunk.size());
+        header.columnBytes[COL_HEAP] = heap.size();
+        chunk.resize(header.columnOffset[COL_HEAP]);
+        chunk.append(heap.begin(), heap.end());
+        memcpy(&chunk[0], &header, sizeof(header));
+        return chunk;
+    }
+
+    static size_t indexPageEntries(const RollIndex &index, size_t page)
+    {
+        return min(RollIndex::PAGE_ENTRIES, index.tableSize() - page * RollIndex::PAGE_ENTRIES);
+    }
+
+    // Appends the directory and publishes it through the header slot for `generation`
+    static bool publish(int fd, SnapshotHeader header, const vector<ChunkRef> &directory, uint64_t &end,
+                        bool bothSlots)
+    {
+        end = align8(end);
+        header.directoryOffset = end;
+        if (!writeAt(fd, end, directory.data(), directory.size() * sizeof(ChunkRef)))
+            return false;
+        end += directory.size() * sizeof(ChunkRef);
+        header.fileBytes = end;
+        header.checksum = headerChecksum(header);
+
+        // Everything the header points at has to be on disk before the header is
+        if (fdatasync(fd) != 0)
+            return false;
+        for (uint64_t slot = 0; slot < 2; ++slot)
+        {
+            if (!bothSlots && slot != header.generation % 2)
+                continue;
+            if (!writeAt(fd, slot * HEADER_SLOT, &header, sizeof(header)))
+                return false;
+        }
+        return fdatasync(fd) == 0;
+    }
+
+    static SnapshotHeader makeHeader(const StudentTable &students, const RollIndex &index,
+                                     const SnapshotMeta &meta, uint64_t generation)
+    {
+        SnapshotHeader header = {};
+        copy(SNAPSHOT_MAGIC, SNAPSHOT_MAGIC + 8, header.magic);
+        header.version = SNAPSHOT_VERSION;
+        header.generation = generation;
+        header.rowCount = students.size();
+        header.segmentCount = students.segmentCount();
+        header.indexCount = index.size();
+        header.indexCapacity = index.tableSize();
+        header.gradingFingerprint = meta.gradingFingerprint;
+        header.journalSequence = meta.journalSequence;
+        header.symbolCount = students.symbolTable().size();
+        header.listOrder = uint64_t(meta.listOrder);
+        return header;
+    }
+
+    // Writes the whole roster to a new file and renames it over `filename`
+    static bool writeSnapshot(const StudentTable &students, const RollIndex &index, const SnapshotMeta &meta,
+                              const string &filename, SnapshotLayout *layout, SaveStats &stats)
+    {
+        string temp = filename + ".tmp";
+        int fd = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0)
+        {
+            cout << "Failed to write " << temp << "\n";
+            return false;
+        }
+
+        vector<ChunkRef> directory;
+        uint64_t end = 2 * HEADER_SLOT;
+        bool ok = true;
+        for (size_t k = 0; ok && k < students.segmentCount(); ++k)
+        {
+            string chunk = encodeSegment(students, k);
+            end = align8(end);
+            ok = writeAt(fd, end, chunk.data(), chunk.size());
+            directory.push_back(ChunkRef{end, chunk.size()});
+            end += chunk.size();
+        }
+        for (size_t p = 0; ok && p < index.pageCount(); ++p)
+        {
+            size_t bytes = indexPageEntries(index, p) * sizeof(RollIndex::Entry);
+            end = align8(end);
+            ok = writeAt(fd, end, index.entries() + p * RollIndex::PAGE_ENTRIES, bytes);
+            directory.push_back(ChunkRef{end, bytes});
+            end += bytes;
+        }
+        ChunkRef symbols = {}, attendance = {};
+        ok = ok && writeSymbols(fd, students.symbolTable(), end, symbols);
+        ok = ok && writeAttendance(fd, meta.attendance, end, attendance);
+
+        uint64_t live = symbols.bytes + attendance.bytes;
+        for (const auto &ref : directory)
+            live += ref.bytes;
+        uint64_t generation = layout ? layout->generation + 1 : 1;
+        SnapshotHeader header = makeHeader(students, index, meta, generation);
+        header.liveBytes = live;
+        header.symbols = symbols;
+        header.attendance = attendance;
+        ok = ok && publish(fd, header, directory, end, true);
+        ::close(fd);
+        if (!ok)
+        {
+            cout << "Failed to write " << temp << "\n";
+            return false;
+        }
+        if (rename(temp.c_str(), filename.c_str()) != 0)
+        {
+            cout << "Failed to replace " << filename << "\n";
+            return false;
+        }
+
+        stats.bytesWritten = end;
+        stats.segmentsWritten = stats.segments = students.segmentCount();
+        stats.indexPagesWritten = index.pageCount();
+        stats.rewritten = true;
+        if (layout)
+        {
+            layout->filename = filename;
+            layout->generation = generation;
+            layout->fileBytes = end;
+            layout->liveBytes = live;
+            layout->indexCapacity = index.tableSize();
+            layout->symbolCount = header.symbolCount;
+            layout->symbols = symbols;
+            layout->attendanceChanges = meta.attendance ? meta.attendance->changes() : 0;
+            layout->attendance = attendance;
+            layout->segments.assign(directory.begin(), directory.begin() + students.segmentCount());
+            layout->indexPages.assign(directory.begin() + students.segmentCount(), directory.end());
+        }
+        return true;
+    }
+
+public:
+    // Writes a complete, compact snapshot (backups and conversions)
+    static bool saveSnapshot(const StudentTable &students, const RollIndex &index, const SnapshotMeta &meta,
+                             const string &filename = "students.dat")
+    {
+        SaveStats stats;
+        return writeSnapshot(students, index, meta, filename, nullptr, stats);
+    }
+
+    // Saves the roster into the snapshot described by `layout`, writing only the
+    // segments and index pages that changed since it was loaded or last saved.
+    // Falls back to a full rewrite for a new file or when the old one is mostly
+    // stale chunks.
+    static bool saveChanges(StudentTable &students, RollIndex &index, const SnapshotMeta &meta,
+                            SnapshotLayout &layout, SaveStats &stats, const string &filename = "students.dat")
+    {
+        stats = SaveStats();
+        stats.changedRows = students.dirtyRows();
+        stats.segments = students.segmentCount();
+
+        size_t dirtySegments = 0;
+        for (size_t k = 0; k < students.segmentCount(); ++k)
+        {
+            if (k >= layout.segments.size() || students.segmentDirty(k))
+                ++dirtySegments;
+        }
+        bool rewrite = layout.filename != filename || layout.generation == 0 ||
+                       layout.fileBytes > 2 * layout.liveBytes + (1 << 20) ||
+                       dirtySegments * 2 > students.segmentCount();
+
+        int fd = rewrite ? -1 : ::open(filename.c_str(), O_RDWR);
+        if (fd < 0)
+        {
+            if (!writeSnapshot(students, index, meta, filename, &layout, stats))
+                return false;
+            students.markClean();
+            index.markClean();
+            return true;
+        }
+
+        vector<ChunkRef> directory;
+        uint64_t end = layout.fileBytes;
+        bool ok = true;
+        for (size_t k = 0; ok && k < students.segmentCount(); ++k)
+        {
+            if (k < layout.segments.size() && !students.segmentDirty(k))
+            {
+                directory.push_back(layout.segments[k]);
+                continue;
+            }
+            string chunk = encodeSegment(students, k);
+            end = align8(end);
+            ok = writeAt(fd, end, chunk.data(), chunk.size());
+            directory.push_back(ChunkRef{end, chunk.size()});
+            end += chunk.size();
+            stats.segmentsWritten++;
+        }
+        bool sameIndex = index.tableSize() == layout.indexCapacity;
+        for (size_t p = 0; ok && p < index.pageCount(); ++p)
+        {
+            if (sameIndex && p < layout.indexPages.size() && !index.pageDirty(p))
+            {
+                directory.push_back(layout.indexPages[p]);
+                continue;
+            }
+            size_t bytes = indexPageEntries(index, p) * sizeof(RollIndex::Entry);
+            end = align8(end);
+            ok = writeAt(fd, end, index.entries() + p * RollIndex::PAGE_ENTRIES, bytes);
+            directory.push_back(ChunkRef{end, bytes});
+            end += bytes;
+            stats.indexPagesWritten++;
+        }
+        ChunkRef symbols = layout.symbols;
+        if (students.symbolTable().size() != layout.symbolCount)
+            ok = ok && writeSymbols(fd, students.symbolTable(), end, symbols);
+        ChunkRef attendance = layout.attendance;
+        if (meta.attendance && meta.attendance->changes() != layout.attendanceChanges)
+            ok = ok && writeAttendance(fd, meta.attendance, end, attendance);
+
+        uint64_t live = symbols.bytes + attendance.bytes;
+        for (const auto &ref : directory)
+            live += ref.bytes;
+        uint64_t start = layout.fileBytes;
+        SnapshotHeader header = makeHeader(students, index, meta, layout.generation + 1);
+        header.liveBytes = live;
+        header.symbols = symbols;
+        header.attendance = attendance;
+        ok = ok && publish(fd, header, directory, end, false);
+        ::close(fd);
+        if (!ok)
+        {
+            cout << "Failed to write " << filename << "\n";
+            return false;
+        }
+
+        stats.bytesWritten = end - start + sizeof(header);
+        layout.generation++;
+        layout.fileBytes = end;
+        layout.liveBytes = live;
+        layout.indexCapacity = index.tableSize();
+        layout.symbolCount = header.symbolCount;
+        layout.symbols = symbols;
+        if (meta.attendance)
+            layout.attendanceChanges = meta.attendance->changes();
+        layout.attendance = attendance;
+        layout.segments.assign(directory.begin(), directory.begin() + students.segmentCount());
+        layout.indexPages.assign(directory.begin() + students.segmentCount(), directory.end());
+        students.markClean();
+        index.markClean();
+        return true;
+    }
+
+    // Maps a snapshot and serves the roster straight from it: no rows are copied
+    // and the saved roll-number index is used in place when its pages are
+    // contiguous. If the index is unusable, `index` is left empty and the caller
+    // has to rebuild it. `layout`, if given, receives where every chunk lives.
+    static bool mapSnapshot(const string &filename, StudentTable &students, RollIndex &index,
+                            SnapshotMeta &meta, SnapshotLayout *layout = nullptr)
+    {
+        auto file = make_shared<MappedFile>();
+        if (!file->open(filename))
+        {
+            cout << "Failed to open file: " << filename << "\n";
+            return false;
+        }
+        if (file->size() < 2 * HEADER_SLOT || !equal(SNAPSHOT_MAGIC, SNAPSHOT_MAGIC + 8, file->data()))
+        {
+            cout << filename << " is not a student snapshot.\n";
+            return false;
+        }
+
+        // Use the newest header slot that is intact
+        SnapshotHeader header = {};
+        bool found = false;
+        uint32_t version = 0;
+        for (uint64_t slot = 0; slot < 2; ++slot)
+        {
+            SnapshotHeader candidate;
+            memcpy(&candidate, file->data() + slot * HEADER_SLOT, sizeof(candidate));
+            if (!equal(SNAPSHOT_MAGIC, SNAPSHOT_MAGIC + 8, candidate.magic))
+                continue;
+            version = candidate.version;
+            uint64_t chunks = candidate.segmentCount +
+                              (candidate.indexCapacity + RollIndex::PAGE_ENTRIES - 1) / RollIndex::PAGE_ENTRIES;
+            bool valid = candidate.version == SNAPSHOT_VERSION &&
+                         candidate.checksum == headerChecksum(candidate) &&
+                         candidate.fileBytes <= file->size() && candidate.directoryOffset % 8 == 0 &&
+                         chunks < file->size() && candidate.directoryOffset <= candidate.fileBytes &&
+                         chunks * sizeof(ChunkRef) <= candidate.fileBytes - candidate.directoryOffset;
+            if (valid && (!found || candidate.generation > header.generation))
+            {
+                header = candidate;
+                found = true;
+            }
+        }
+        if (!found)
+        {
+            if (version != SNAPSHOT_VERSION)
+                cout << filename << " has unsupported snapshot version " << version << ".\n";
+            else
+                cout << filename << " is truncated or corrupt.\n";
+            return false;
+        }
+
+        char *base = file->data();
+        vector<ChunkRef> directory(header.segmentCount +
+                                   (header.indexCapacity + RollIndex::PAGE_ENTRIES - 1) / RollIndex::PAGE_ENTRIES);
+        memcpy(directory.data(), base + header.directoryOffset, directory.size() * sizeof(ChunkRef));
+        auto chunkValid = [&](const ChunkRef &ref)
+        {
+            return ref.offset % 8 == 0 && ref.offset <= header.fileBytes &&
+                   ref.bytes <= header.fileBytes - ref.offset;
+        };
+
+        vector<StudentTable::MappedSegment> segments(header.segmentCount);
+        uint64_t rows = 0;
+        for (size_t k = 0; k < segments.size(); ++k)
+        {
+            const ChunkRef &ref = directory[k];
+            SegmentHeader sh;
+            bool valid = chunkValid(ref) && ref.bytes >= sizeof(sh);
+            if (valid)
+            {
+                memcpy(&sh, base + ref.offset, sizeof(sh));
+                bool last = k + 1 == segments.size();
+                valid = sh.columnCount == COL_COUNT && sh.rows > 0 && sh.rows <= StudentTable::SEGMENT_ROWS &&
+                        (last || sh.rows == StudentTable::SEGMENT_ROWS);
+                for (int c = 0; valid && c < COL_COUNT; ++c)
+                {
+                    uint64_t expected = c == COL_HEAP ? sh.columnBytes[c] : sh.rows * columnWidth(c);
+                    valid = sh.columnBytes[c] == expected && sh.columnOffset[c] % 8 == 0 &&
+                            sh.columnOffset[c] <= ref.bytes && sh.columnBytes[c] <= ref.bytes - sh.columnOffset[c];
+                }
+            }
+            if (!valid)
+            {
+                cout << filename << " is truncated or corrupt.\n";
+                return false;
+            }
+
+            const char *chunk = base + ref.offset;
+            StudentTable::MappedSegment &m = segments[k];
+            m.rows = sh.rows;
+            m.rollNo = reinterpret_cast<const int32_t *>(chunk + sh.columnOffset[COL_ROLL]);
+            m.age = reinterpret_cast<const int32_t *>(chunk + sh.columnOffset[COL_AGE]);
+            for (int s = 0; s < 5; ++s)
+                m.marks[s] = reinterpret_cast<const float *>(chunk + sh.columnOffset[COL_MARKS + s]);
+            m.percentage = reinterpret_cast<const float *>(chunk + sh.columnOffset[COL_PERCENTAGE]);
+            m.grade = chunk + sh.columnOffset[COL_GRADE];
+            m.name = reinterpret_cast<const uint32_t *>(chunk + sh.columnOffset[COL_NAME]);
+            for (int f = 0; f < StudentTable::SYMBOL_FIELDS; ++f)
+                m.symbol[f] = reinterpret_cast<const uint16_t *>(chunk + sh.columnOffset[COL_CLASS + f]);
+            m.heap = chunk + sh.columnOffset[COL_HEAP];
+            m.heapBytes = sh.columnBytes[COL_HEAP];
+            rows += sh.rows;
+        }
+        if (rows != header.rowCount)
+        {
+            cout << filename << " is truncated or corrupt.\n";
+            return false;
+        }
+
+        // Symbols are re-interned in id order, so the ids in the segments stay valid
+        SymbolTable symbols;
+        bool symbolsValid = chunkValid(header.symbols) && header.symbolCount >= 1 &&
+                            header.symbolCount <= SymbolTable::MAX_SYMBOLS;
+        const char *next = base + header.symbols.offset, *stop = next + (symbolsValid ? header.symbols.bytes : 0);
+        for (uint64_t id = 1; symbolsValid && id < header.symbolCount; ++id)
+        {
+            uint32_t length;
+            symbolsValid = stop - next >= ptrdiff_t(sizeof(length));
+            if (!symbolsValid)
+                break;
+            memcpy(&length, next, sizeof(length));
+            next += sizeof(length);
+            symbolsValid = length <= uint64_t(stop - next) && symbols.intern(string_view(next, length)) == id;
+            next += length;
+        }
+        if (!symbolsValid)
+        {
+            cout << filename << " is truncated or corrupt.\n";
+            return false;
+        }
+        bool attendanceValid = chunkValid(header.attendance);
+        if (attendanceValid && meta.attendance && header.attendance.bytes)
+            attendanceValid = meta.attendance->decode(string_view(base + header.attendance.offset, header.attendance.bytes));
+        else if (attendanceValid && meta.attendance)
+            meta.attendance->clear();
+        if (!attendanceValid)
+        {
+            cout << filename << " is truncated or corrupt.\n";
+            return false;
+        }
+        students.attach(file, segments, move(symbols));
+
+        // The index pages are used in place when they sit back to back in the file
+        index.clear();
+        bool indexValid = header.indexCount == header.rowCount &&
+                          RollIndex::validShape(header.indexCapacity, header.indexCount);
+        bool contiguous = true;
+        for (size_t p = 0; indexValid && p + segments.size() < directory.size(); ++p)
+        {
+            const ChunkRef &ref = directory[segments.size() + p];
+            size_t entries = min<uint64_t>(RollIndex::PAGE_ENTRIES, header.indexCapacity - p * RollIndex::PAGE_ENTRIES);
+            indexValid = chunkValid(ref) && ref.bytes == entries * sizeof(RollIndex::Entry);
+            if (p > 0 && ref.offset != directory[segments.size()].offset + p * RollIndex::PAGE_ENTRIES * sizeof(RollIndex::Entry))
+                contiguous = false;
+        }
+        if (indexValid && contiguous)
+        {
+            auto *entries = reinterpret_cast<RollIndex::Entry *>(base + directory[segments.size()].offset);
+            index.attach(entries, header.indexCapacity, header.indexCount);
+        }
+        else if (indexValid)
+        {
+            vector<RollIndex::Entry> entries(header.indexCapacity);
+            for (size_t p = 0; p + segments.size() < directory.size(); ++p)
+            {
+                const ChunkRef &ref = directory[segments.size() + p];
+                memcpy(&entries[p * RollIndex::PAGE_ENTRIES], base + ref.offset, ref.bytes);
+            }
+            index.adopt(move(entries), header.indexCount);
+        }
+
+        meta.gradingFingerprint = header.gradingFingerprint;
+        meta.journalSequence = header.journalSequence;
+        meta.listOrder = header.listOrder < uint64_t(SortKey::COUNT) ? SortKey(header.listOrder) : SortKey::COUNT;
+        if (layout)
+        {
+            layout->filename = filename;
+            layout->generation = header.generation;
+            layout->fileBytes = header.fileBytes;
+            layout->liveBytes = header.liveBytes;
+            layout->indexCapacity = header.indexCapacity;
+            layout->symbolCount = header.symbolCount;
+            layout->symbols = header.symbols;
+            layout->attendanceChanges = meta.attendance ? meta.attendance->changes() : 0;
+            layout->attendance = header.attendance;
+            layout->segments.assign(directory.begin(), directory.begin() + segments.size());
+            layout->indexPages.assign(directory.begin() + segments.size(), directory.end());
+        }
+        return true;
+    }
+
+    // Converts between students.txt-style text files and binary snapshots. The
+    // input format is detected from the file contents, the output format from
+    // the extension (".dat" is a snapshot, anything else is text).
+    static bool convert(const string &from, const string &to)
+    {
+        StudentTable students;
+        RollIndex index;
+        SnapshotMeta meta; // grades from a text file are not trusted
+        AttendanceLog history; // carried over between snapshots; text files have none
+        meta.attendance = &history;
+        if (isSnapshot(from))
+        {
+            if (!mapSnapshot(from, students, index, meta))
+                return false;
+        }
+        else
+        {
+            if (!ifstream(from))
+            {
+                cout << "Failed to open file: " << from << "\n";
+                return false;
+            }
+            students.reserve(0, textBytes(from));
+            loadFromFile(from, [&](const Student &s)
+                         {
+                             if (index.insert(s.rollNo, students.size()))
+                                 students.append(s); });
+        }
+
+        bool toSnapshot = to.size() >= 4 && to.compare(to.size() - 4, 4, ".dat") == 0;
+        if (toSnapshot)
+        {
+            if (index.size() != students.size())
+            {
+                index.clear();
+                for (size_t i = 0; i < students.size(); ++i)
+                    index.insert(students.rollNo(i), i);
+            }
+            if (!saveSnapshot(students, index, meta, to))
+                return false;
+        }
+        else
+        {
+            saveToFile(students, to);
+        }
+        cout << "Converted " << students.size() << " students from " << from << " to " << to << "\n";
+        return true;
+    }
+};
+
+// CSV reader for large imports. Rows are split without copying: a vectorized
+// scan (SSE2 where available) jumps straight to the next delimiter, quote or
+// newline, fields are views into the input, and numbers are parsed with
+// from_chars. Quoted fields such as "Khan, Ali" are used in place; only ones
+// with doubled quotes ("the ""best""") are unescaped into a per-row scratch
+// buffer. The input is either streamed in big blocks on the calling thread
+// (forEachRow) or mapped and parsed in newline-aligned chunks on a thread pool
+// (forEachRecord).
+class CsvReader
+{
+public:
+    struct Stats
+    {
+        size_t rows = 0;      // data rows, header excluded
+        size_t malformed = 0; // rows rejected by the parser or by the row handler
+        size_t firstMalformedRow = 0;
+        uint64_t bytes = 0;
+        double seconds = 0;
+        size_t chunks = 0;
+        size_t chunksReparsed = 0; // chunks whose guessed start fell inside a quoted field
+    };
+
+    static constexpr size_t BLOCK_BYTES = 4 << 20;
+    static constexpr size_t CHUNK_BYTES = 8 << 20;
+
+private:
+    // First byte in [p, end) equal to a, b or c
+    static const char *scan(const char *p, const char *end, char a, char b, char c)
+    {
+#ifdef __SSE2__
+        const __m128i va = _mm_set1_epi8(a), vb = _mm_set1_epi8(b), vc = _mm_set1_epi8(c);
+        for (; end - p >= 16; p += 16)
+        {
+            __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+            __m128i hits = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(bytes, va), _mm_cmpeq_epi8(bytes, vb)),
+                                        _mm_cmpeq_epi8(bytes, vc));
+            int mask = _mm_movemask_epi8(hits);
+            if (mask)
+                return p + __builtin_ctz(mask);
+        }
+#endif
+        for (; p < end; ++p)
+        {
+            if (*p == a || *p == b || *p == c)
+                return p;
+        }
+        return end;
+    }
+
+    // Newline that ends the row starting at p (ignoring newlines inside quoted
+    // fields), or nullptr if the input ends first. As in split(), a quote only
+    // opens a quoted field at the start of the field, so a stray quote cannot
+    // swallow the rows after it.
+    static const char *rowEnd(const char *p, const char *end)
+    {
+        const char *rowStart = p;
+        bool quoted = false;
+        while ((p = scan(p, end, '\n', '"', '"')) != end)
+        {
+            if (*p == '\n')
+            {
+                if (!quoted)
+                    return p;
+            }
+            else if (quoted)
+            {
+                if (p + 1 == end)
+                    return nullptr; // "" or a closing quote; more input decides
+                if (p[1] == '"')
+                    ++p;
+                else
+                    quoted = false;
+            }
+            else if (p == rowStart || p[-1] == ',')
+            {
+                quoted = true;
+            }
+            ++p;
+        }
+        return nullptr;
+    }
+
+    // Splits one row into fields. Returns false if the quoting is broken.
+    static bool split(const char *p, const char *end, vector<string_view> &fields, string &scratch)
+    {
+        fields.clear();
+        scratch.clear();
+        scratch.reserve(end - p); // unescaped text is never longer, so views into it stay valid
+        if (end > p && end[-1] == '\r')
+            --end;
+        while (true)
+        {
+            if (p < end && *p == '"')
+            {
+                const char *start = ++p;
+                const char *q = scan(p, end, '"', '"', '"');
+                if (q == end)
+                    return false; // unterminated quote
+                if (q + 1 < end && q[1] == '"')
+                {
+                    // Doubled quotes: build the unescaped value in scratch
+                    size_t from = scratch.size();
+                    while (true)
+                    {
+                        scratch.append(p, q - p);
+                        if (q == end)
+                            return false;
+                        if (q + 1 < end && q[1] == '"')
+                        {
+                            scratch += '"';
+                            p = q + 2;
+                            q = scan(p, end, '"', '"', '"');
+                            continue;
+                        }
+                        break;
+                    }
+                    fields.emplace_back(scratch.data() + from, scratch.size() - from);
+                }
+                else
+                {
+                    fields.emplace_back(start, q - start);
+                }
+                p = q + 1;
+                if (p == end)
+                    return true;
+                if (*p++ != ',')
+                    return false;
+            }
+            else
+            {
+                const char *q = scan(p, end, ',', '"', ',');
+                if (q != end && *q == '"')
+                    return false; // a quote in the middle of an unquoted field
+                fields.emplace_back(p, q - p);
+                if (q == end)
+                    return true;
+                p = q + 1;
+            }
+        }
+    }
+
+    // Rows parsed by one worker, kept in file order
+    template <typename Record>
+    struct Chunk
+    {
+        const char *start = nullptr; // where this chunk assumed its first row begins
+        const char *end = nullptr;   // just past the last row it parsed
+        vector<Record> records;
+        vector<size_t> malformedRows; // 1-based, relative to the chunk
+        size_t rows = 0;
+    };
+
+    // First row boundary at or after p (the byte after a newline)
+    static const char *alignToRow(const char *p, const char *begin, const char *end)
+    {
+        if (p <= begin)
+            return begin;
+        const char *newline = static_cast<const char *>(memchr(p - 1, '\n', end - (p - 1)));
+        return newline ? newline + 1 : end;
+    }
+
+    // Parses every row that starts in [from, limit); the last one may run past limit
+    template <typename Record, typename ParseFn>
+    static void parseRange(const char *from, const char *limit, const char *end, ParseFn &parse,
+                           Chunk<Record> &chunk)
+    {
+        vector<string_view> fields;
+        string scratch;
+        Record record;
+        const char *p = from;
+        while (p < limit)
+        {
+            const char *newline = rowEnd(p, end);
+            const char *last = newline ? newline : end;
+            if (last > p && !(last - p == 1 && *p == '\r'))
+            {
+                ++chunk.rows;
+                if (split(p, last, fields, scratch) && parse(fields, record))
+                    chunk.records.push_back(move(record));
+                else
+                    chunk.malformedRows.push_back(chunk.rows);
+            }
+            p = newline ? newline + 1 : end;
+        }
+        chunk.start = from;
+        chunk.end = p;
+    }
+
+public:
+    // Parses a whole field as a number, allowing surrounding spaces
+    template <typename T>
+    static bool parse(string_view text, T &value)
+    {
+        while (!text.empty() && text.front() == ' ')
+            text.remove_prefix(1);
+        while (!text.empty() && text.back() == ' ')
+            text.remove_suffix(1);
+        auto result = from_chars(text.data(), text.data() + text.size(), value);
+        return result.ec == errc() && result.ptr == text.data() + text.size();
+    }
+
+    // Guesses the number of rows from the file size and the first 64 KB
+    static size_t estimateRows(const string &filename)
+    {
+        ifstream file(filename, ios::binary | ios::ate);
+        if (!file)
+            return 0;
+        uint64_t size = file.tellg();
+        file.seekg(0);
+        vector<char> sample(min<uint64_t>(size, 64 << 10));
+        file.read(sample.data(), sample.size());
+        size_t lines = count(sample.begin(), sample.end(), '\n');
+        return lines ? static_cast<size_t>(size * lines / sample.size()) : 0;
+    }
+
+    // Calls onRow(fields) for every data row; the first row is the header. The
+    // fields point into the read buffer and are only valid during the call.
+    // onRow returns false to count the row as malformed.
+    template <typename RowFn>
+    static bool forEachRow(const string &filename, RowFn onRow, Stats &stats)
+    {
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+        auto start = chrono::steady_clock::now();
+        vector<char> buffer(BLOCK_BYTES);
+        vector<string_view> fields;
+        string scratch;
+        size_t filled = 0;
+        bool eof = false, header = true;
+        while (!eof)
+        {
+            ssize_t n = ::read(fd, buffer.data() + filled, buffer.size() - filled);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n < 0)
+            {
+                ::close(fd);
+                return false;
+            }
+            eof = n == 0;
+            filled += n;
+            stats.bytes += n;
+
+            const char *p = buffer.data(), *end = p + filled;
+            while (p < end)
+            {
+                const char *newline = rowEnd(p, end);
+                if (!newline && !eof)
+                    break; // the row continues in the next block
+                const char *last = newline ? newline : end;
+                if (header)
+                {
+                    header = false;
+                }
+                else if (last > p && !(last - p == 1 && *p == '\r'))
+                {
+                    ++stats.rows;
+                    if (!split(p, last, fields, scratch) || !onRow(fields))
+                    {
+                        if (stats.malformed++ == 0)
+                            stats.firstMalformedRow = stats.rows;
+                    }
+                }
+                p = newline ? newline + 1 : end;
+            }
+
+            // Keep the unfinished row; grow the buffer if one row fills all of it
+            filled = buffer.data() + filled - p;
+            memmove(buffer.data(), p, filled);
+            if (filled == buffer.size())
+                buffer.resize(buffer.size() * 2);
+        }
+        stats.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        ::close(fd);
+        return true;
+    }
+
+    // Parallel import: the mapped file is cut into chunks at newlines, workers
+    // run parse(fields, record) over whole chunks, and merge(record) is called
+    // on this thread for every record in file order. Chunk starts are guesses;
+    // if a quoted field contains a newline right at a cut, the previous chunk
+    // ends somewhere else than the next one started, and that chunk is parsed
+    // again from the right place. parse returns false to count a row as malformed.
+    template <typename Record, typename ParseFn, typename MergeFn>
+    static bool forEachRecord(const string &filename, ThreadPool &pool, ParseFn parse, MergeFn merge,
+                              Stats &stats)
+    {
+        MappedFile file;
+        auto started = chrono::steady_clock::now();
+        if (!file.open(filename))
+        {
+            // open() refuses empty files; an empty CSV simply has no rows
+            if (!ifstream(filename))
+                return false;
+            stats.seconds = 0;
+            return true;
+        }
+        posix_madvise(file.data(), file.size(), POSIX_MADV_SEQUENTIAL);
+
+        const char *begin = file.data(), *end = begin + file.size();
+        const char *headerEnd = rowEnd(begin, end);
+        const char *data = headerEnd ? headerEnd + 1 : end;
+        size_t chunkCount = max<size_t>(1, (end - data + CHUNK_BYTES - 1) / CHUNK_BYTES);
+        auto chunkStart = [&](size_t i)
+        {
+            return i >= chunkCount ? end : alignToRow(data + i * CHUNK_BYTES, data, end);
+        };
+        auto submit = [&](size_t i)
+        {
+            return pool.submit([&, i]
+                               {
+                                   Chunk<Record> chunk;
+                                   parseRange(chunkStart(i), chunkStart(i + 1), end, parse, chunk);
+                                   return chunk; });
+        };
+
+        // Keep a bounded window of chunks in flight so memory stays flat
+        deque<future<Chunk<Record>>> inFlight;
+        size_t next = 0, window = 2 * pool.size();
+        const char *expected = data;
+        while (next < chunkCount && inFlight.size() < window)
+            inFlight.push_back(submit(next++));
+        for (size_t i = 0; i < chunkCount; ++i)
+        {
+            Chunk<Record> chunk = inFlight.front().get();
+            inFlight.pop_front();
+            if (next < chunkCount)
+                inFlight.push_back(submit(next++));
+
+            if (chunk.start != expected)
+            {
+                // The previous chunk's last row ran past this chunk's guessed start
+                Chunk<Record> redo;
+                parseRange(expected, max(expected, chunkStart(i + 1)), end, parse, redo);
+                chunk = move(redo);
+                ++stats.chunksReparsed;
+            }
+            expected = chunk.end;
+
+            for (size_t row : chunk.malformedRows)
+            {
+                if (stats.malformed++ == 0)
+                    stats.firstMalformedRow = stats.rows + row;
+            }
+            stats.rows += chunk.rows;
+            for (auto &record : chunk.records)
+                merge(record);
+        }
+        stats.chunks = chunkCount;
+        stats.bytes = file.size();
+        stats.seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+        return true;
+    }
+};
+
+// Append-only write-ahead journal (students.journal). Every change to the roster
+// is appended as one record before the menu moves on; recovery replays the
+// records that are newer than the last snapshot.
+//
+// Record layout: uint32 payload length, uint32 checksum, uint64 sequence,
+// uint8 type, payload. The checksum (FNV-1a) covers sequence, type and payload,
+// so a record torn by a crash is detected and dropped together with the tail.
+//
+// Appends only fill a buffer. A background thread writes the buffer and calls
+// fdatasync once for everything that queued up meanwhile (group commit), and
+// commit() waits for that, so a bulk import pays for one sync, not one per row.
+// The thread is woken by commit(), by 1 MB of queued records, or every 10 ms;
+// never per append.
+class Journal
+{
+public:
+    enum RecordType : uint8_t
+    {
+        ADD = 1,
+        UPDATE,
+        DELETE,
+        MARKS,
+        ATTENDANCE,    // only in journals from before ATTENDANCE_DAY: roll and the new value
+        SORT,          // the list order (a SortKey byte) was chosen
+        ATTENDANCE_DAY // a student was marked present or absent on a given day
+    };
+
+    using ReplayFn = function<void(RecordType type, string_view payload)>;
+
+    struct ReplayResult
+    {
+        size_t records = 0;     // records applied
+        uint64_t lastSequence;  // newest sequence seen in the file (or the one passed in)
+        uint64_t validBytes = 0; // length of the intact part of the file
+        bool torn = false;      // a damaged tail was found and ignored
+        double seconds = 0;
+    };
+
+private:
+    static constexpr char MAGIC[8] = {'S', 'M', 'S', 'J', 'R', 'N', 'L', '\0'};
+    static constexpr size_t RECORD_HEADER = 4 + 4 + 8 + 1;
+
+    int fd = -1;
+    mutable mutex lock;
+    condition_variable wake;    // the flusher has work (or should stop)
+    condition_variable durable; // a batch reached the disk
+    string pending;
+    string writing; // the batch being written; kept to reuse its capacity
+    uint64_t appendedSequence = 0;
+    uint64_t durableSequence = 0;
+    uint64_t fileBytes = 0;
+    bool stopping = false;
+    bool failed = false;
+    bool flushRequested = false;
+    thread flusher;
+
+    static constexpr size_t FLUSH_BYTES = 1 << 20;
+    static constexpr chrono::milliseconds FLUSH_INTERVAL{10};
+
+    static uint32_t checksum(const char *data, size_t length, uint32_t hash = 2166136261u)
+    {
+        for (size_t i = 0; i < length; ++i)
+        {
+            hash ^= static_cast<unsigned char>(data[i]);
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+
+    static bool writeAll(int fd, const char *data, size_t length)
+    {
+        while (length > 0)
+        {
+            ssize_t n = ::write(fd, data, length);
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                return false;
+            }
+            data += n;
+            length -= n;
+        }
+        return true;
+    }
+
+    void flushLoop()
+    {
+        unique_lock<mutex> guard(lock);
+        while (true)
+        {
+            wake.wait_for(guard, FLUSH_INTERVAL, [this]
+                          { return stopping || flushRequested || pending.size() >= FLUSH_BYTES; });
+            flushRequested = false;
+            if (pending.empty())
+            {
+                if (stopping)
+                    break;
+                continue;
+            }
+
+            writing.swap(pending);
+            uint64_t upTo = appendedSequence;
+            guard.unlock();
+            bool ok = writeAll(fd, writing.data(), writing.size()) && fdatasync(fd) == 0;
+            size_t written = writing.size();
+            writing.clear();
+            guard.lock();
+
+            if (!ok && !failed)
+            {
+                failed = true;
+                cout << "Warning: journal write failed; changes since the last save may be lost.\n";
+            }
+            fileBytes += written;
+            durableSequence = upTo;
+            durable.notify_all();
+        }
+    }
+
+    // Leaves room for a record header in the buffer; the payload goes after it
+    size_t startRecord()
+    {
+        size_t at = pending.size();
+        pending.append(RECORD_HEADER, '\0');
+        return at;
+    }
+
+    uint64_t finishRecord(size_t at, RecordType type)
+    {
+        uint64_t sequence = ++appendedSequence;
+        char *header = &pending[at];
+        uint32_t length = static_cast<uint32_t>(pending.size() - at - RECORD_HEADER);
+        memcpy(header, &length, 4);
+        memcpy(header + 8, &sequence, 8);
+        header[16] = static_cast<char>(type);
+        uint32_t sum = checksum(header + 8, 9 + length);
+        memcpy(header + 4, &sum, 4);
+        if (at < FLUSH_BYTES && pending.size() >= FLUSH_BYTES)
+            wake.notify_one();
+        return sequence;
+    }
+
+public:
+    Journal() = default;
+    Journal(const Journal &) = delete;
+    Journal &operator=(const Journal &) = delete;
+
+    ~Journal() { close(); }
+
+    // Reads every intact record with a sequence number above `after` and hands it to apply
+    static ReplayResult replay(const string &filename, uint64_t after, const ReplayFn &apply)
+    {
+        ReplayResult result;
+        result.lastSequence = after;
+        MappedFile file;
+        if (!file.open(filename) || file.size() < sizeof(MAGIC) ||
+            !equal(MAGIC, MAGIC + 8, file.data()))
+            return result;
+
+        auto start = chrono::steady_clock::now();
+        const char *data = file.data();
+        size_t pos = sizeof(MAGIC);
+        while (file.size() - pos >= RECORD_HEADER)
+        {
+            uint32_t length, sum;
+            uint64_t sequence;
+            memcpy(&length, data + pos, 4);
+            memcpy(&sum, data + pos + 4, 4);
+            memcpy(&sequence, data + pos + 8, 8);
+            if (file.size() - pos - RECORD_HEADER < length ||
+                checksum(data + pos + 8, 9 + length) != sum)
+                break;
+
+            RecordType type = static_cast<RecordType>(data[pos + 16]);
+            if (sequence > after)
+            {
+                apply(type, string_view(data + pos + RECORD_HEADER, length));
+                ++result.records;
+            }
+            result.lastSequence = max(result.lastSequence, sequence);
+            pos += RECORD_HEADER + length;
+        }
+        result.validBytes = pos;
+        result.torn = pos != file.size();
+        result.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        return result;
+    }
+
+    // Opens the journal for appending. `validBytes` comes from replay(): anything
+    // after it is a torn tail and is cut off. New records continue after `lastSequence`.
+    bool open(const string &filename, uint64_t validBytes, uint64_t lastSequence)
+    {
+        close();
+        fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+        if (fd < 0)
+        {
+            cout << "Failed to open journal: " << filename << "\n";
+            return false;
+        }
+        bool ok = validBytes < sizeof(MAGIC)
+                      ? ftruncate(fd, 0) == 0 && writeAll(fd, MAGIC, sizeof(MAGIC))
+                      : ftruncate(fd, validBytes) == 0;
+        if (!ok)
+        {
+            // No flusher runs for this fd, so close() must not see it
+            cout << "Failed to prepare journal " << filename << ": " << strerror(errno) << "\n";
+            ::close(fd);
+            fd = -1;
+            return false;
+        }
+        validBytes = max<uint64_t>(validBytes, sizeof(MAGIC));
+        fdatasync(fd);
+
+        appendedSequence = durableSequence = lastSequence;
+        fileBytes = validBytes;
+        stopping = failed = flushRequested = false;
+        flusher = thread(&Journal::flushLoop, this);
+        return true;
+    }
+
+    void close()
+    {
+        if (fd < 0)
+            return;
+        {
+            lock_guard<mutex> guard(lock);
+            stopping = true;
+        }
+        wake.notify_one();
+        flusher.join();
+        ::close(fd);
+        fd = -1;
+    }
+
+    bool isOpen() const { return fd >= 0; }
+
+    // Queues a record and returns its sequence number; call commit() to wait for it
+    uint64_t append(RecordType type, string_view payload)
+    {
+        lock_guard<mutex> guard(lock);
+        if (fd < 0)
+            return ++appendedSequence;
+        size_t at = startRecord();
+        pending.append(payload);
+        return finishRecord(at, type);
+    }
+
+    // Same as append(type, encodeStudent(s)) but encodes straight into the buffer
+    uint64_t appendStudent(RecordType type, const Student &s)
+    {
+        lock_guard<mutex> guard(lock);
+        if (fd < 0)
+            return ++appendedSequence;
+        size_t at = startRecord();
+        ByteWriter out(pending);
+        encodeStudent(out, s);
+        return finishRecord(at, type);
+    }
+
+    // Blocks until every record appended so far is on disk
+    bool commit()
+    {
+        unique_lock<mutex> guard(lock);
+        if (fd < 0)
+            return false;
+        uint64_t target = appendedSequence;
+        flushRequested = true;
+        wake.notify_one();
+        durable.wait(guard, [&]
+                     { return durableSequence >= target; });
+        return !failed;
+    }
+
+    // Empties the journal once its records are folded into a snapshot
+    bool reset()
+    {
+        unique_lock<mutex> guard(lock);
+        if (fd < 0)
+            return false;
+        flushRequested = true;
+        wake.notify_one();
+        durable.wait(guard, [this]
+                     { return durableSequence >= appendedSequence; });
+        if (ftruncate(fd, sizeof(MAGIC)) != 0)
+            return false;
+        fdatasync(fd);
+        fileBytes = sizeof(MAGIC);
+        return true;
+    }
+
+    uint64_t lastSequence() const
+    {
+        lock_guard<mutex> guard(lock);
+        return appendedSequence;
+    }
+
+    uint64_t size() const
+    {
+        lock_guard<mutex> guard(lock);
+        return fileBytes + pending.size();
+    }
+
+    // ---- Record payloads ----
+
+    static void encodeStudent(ByteWriter &out, const Student &s)
+    {
+        out.put<int32_t>(s.rollNo);
+        out.put<int32_t>(s.age);
+        for (float mark : s.marks)
+            out.put(mark);
+        out.put(s.percentage);
+        out.put(s.grade);
+        out.putString(s.name);
+        out.putString(s.studentClass);
+        out.putString(s.gender);
+        out.putString(s.attendance);
+    }
+
+    static bool decodeStudent(string_view payload, Student &s)
+    {
+        ByteReader in(payload);
+        int32_t roll, age;
+        if (!in.get(roll) || !in.get(age))
+            return false;
+        s.rollNo = roll;
+        s.age = age;
+        for (float &mark : s.marks)
+        {
+            if (!in.get(mark))
+                return false;
+        }
+        return in.get(s.percentage) && in.get(s.grade) && in.getString(s.name) &&
+               in.getString(s.studentClass) && in.getString(s.gender) && in.getString(s.attendance);
+    }
+
+    static string encodeRoll(int roll)
+    {
+        string bytes;
+        ByteWriter out(bytes);
+        out.put<int32_t>(roll);
+        return bytes;
+    }
+
+    static string encodeMarks(int roll, const float marks[5])
+    {
+        string bytes;
+        ByteWriter out(bytes);
+        out.put<int32_t>(roll);
+        for (int i = 0; i < 5; ++i)
+            out.put(marks[i]);
+        return bytes;
+    }
+
+    static string encodeAttendanceDay(int roll, int32_t day, bool present)
+    {
+        string bytes;
+        ByteWriter out(bytes);
+        out.put<int32_t>(roll);
+        out.put<int32_t>(day);
+        out.put<uint8_t>(present);
+        return bytes;
+    }
+};
+
+class AuthManager
+{
+private:
+    static string username;
+    static string password;
+
+public:
+    static bool authenticate()
+    {
+        string user, pass;
+        cout << "Username: ";
+        cin >> user;
+        cout << "Password: ";
+        cin >> pass;
+        return user == username && pass == password;
+    }
+
+    // Feature 1: Update Password
+    static void updatePassword()
+    {
+        string newPass, confirmPass;
+        cout << "Enter new password: ";
+        cin >> newPass;
+        cout << "Confirm new password: ";
+        cin >> confirmPass;
+        if (newPass == confirmPass)
+        {
+            password = newPass;
+            cout << "Password updated successfully.\n";
+        }
+        else
+        {
+            cout << "Passwords do not match. Update failed.\n";
+        }
+    }
+};
+
+// Initialize static members
+string AuthManager::username = "admin";
+string AuthManager::password = "1234";
+
+// ==================== Student Operations ====================
+
+class StudentOperations
+{
+protected:
+    StudentTable students;
+    RollIndex rollIndex; // rollNo -> slot in students, kept in sync by every mutation
+    mutable SlotMap handles;       // stable handles for the indexes below, built with them
+    mutable ClassIndex classIndex; // class -> students, built by the first class query
+    mutable array<unique_ptr<SortedView>, size_t(SortKey::COUNT)> views; // built the first time they are listed
+    SortKey listOrder = SortKey::COUNT; // order View All and exports use; COUNT lists the table as stored
+    bool verifyStats = false;           // cross-check indexes against a full recompute
+    unique_ptr<RecordDirectory> published; // lock-free copies for other threads, once publishRecords() runs
+    AttendanceLog attendanceLog; // marks by day; the attendance column holds the newest
+    shared_ptr<IGradeCalculator> gradeCalc; // Changed to interface
+    Journal journal;     // every change is logged here before it is acknowledged
+    FileHandler::SnapshotLayout layout; // chunks of students.dat the next save can reuse
+    bool keepSnapshot = false;          // students.dat was unreadable and could not be moved aside
+
+    // Fold the journal into students.dat once it grows past this
+    static constexpr uint64_t CHECKPOINT_BYTES = 16ull << 20;
+
+    // Slot of the student with this roll number, or RollIndex::npos
+    size_t findSlot(int roll) const
+    {
+        size_t slot = rollIndex.find(roll);
+        if (slot >= students.size() || students.rollNo(slot) != roll)
+            return RollIndex::npos;
+        return slot;
+    }
+
+    // Compares two handles the way the view for key orders them
+    auto viewOrder(SortKey key) const
+    {
+        return [this, key](uint32_t a, uint32_t b)
+        { return RosterSort::before(students, key, handles.slotAt(a), handles.slotAt(b)); };
+    }
+
+    // Appends a student unless the roll number is already taken
+    bool addRecord(const Student &s)
+    {
+        if (!rollIndex.insert(s.rollNo, students.size()))
+            return false;
+        StudentHandle handle = handles.insert(students.size());
+        classIndex.insert(students.size(), s);
+        students.append(s);
+        if (published)
+            published->put(s);
+        for (size_t k = 0; k < views.size(); ++k)
+        {
+            if (views[k])
+                views[k]->insert(handle.index, viewOrder(SortKey(k)));
+        }
+        return true;
+    }
+
+    // O(1) delete: the last record is moved into the freed slot
+    bool removeByRoll(int roll)
+    {
+        size_t slot = findSlot(roll);
+        if (slot == RollIndex::npos)
+            return false;
+        rollIndex.erase(roll);
+        classIndex.remove(students, slot);
+        attendanceLog.forget(roll);
+        if (published)
+            published->erase(roll);
+        for (size_t k = 0; k < views.size(); ++k)
+        {
+            if (views[k])
+                views[k]->erase(handles.handleOf(slot).index, viewOrder(SortKey(k)));
+        }
+        handles.remove(slot);
+        size_t last = students.size() - 1;
+        if (slot != last)
+        {
+            students.copyRow(last, slot);
+            rollIndex.update(students.rollNo(slot), slot);
+        }
+        students.popBack();
+        return true;
+    }
+
+    bool updateRecord(const Student &s)
+    {
+        size_t slot = findSlot(s.rollNo);
+        if (slot == RollIndex::npos)
+            return false;
+        uint8_t moved = unlist(slot, s);
+        classIndex.update(students, slot, s);
+        students.set(slot, s);
+        relist(slot, moved);
+        if (published)
+            published->put(s);
+        return true;
+    }
+
+    // Returns the new grade, or 0 if the student does not exist
+    char setMarks(int roll, const float marks[5])
+    {
+        size_t slot = findSlot(roll);
+        if (slot == RollIndex::npos)
+            return 0;
+        Student s = students.get(slot);
+        copy(marks, marks + 5, s.marks);
+        gradeCalc->calculateGrade(s); // Use interface
+        uint8_t moved = unlist(slot, s);
+        classIndex.update(students, slot, s);
+        students.set(slot, s);
+        relist(slot, moved);
+        if (published)
+            published->put(s);
+        return s.grade;
+    }
+
+    bool setAttendance(int roll, string_view attendance)
+    {
+        size_t slot = findSlot(roll);
+        if (slot == RollIndex::npos)
+            return false;
+        students.setAttendance(slot, attendance);
+        if (published)
+            published->put(students.get(slot));
+        return true;
+    }
+
+    // Marks a student present or absent on day. The attendance column only
+    // changes when day is the newest one in the history.
+    bool markDay(int roll, int32_t day, bool present)
+    {
+        size_t slot = findSlot(roll);
+        if (slot == RollIndex::npos)
+            return false;
+        bool newest = day >= attendanceLog.lastDay();
+        if (!attendanceLog.mark(students.studentClass(slot), day, roll, present))
+            return false;
+        if (newest)
+        {
+            students.setAttendance(slot, present ? "Present" : "Absent");
+            if (published)
+                published->put(students.get(slot));
+        }
+        return true;
+    }
+
+    // Workers for bulk work, if this object has any
+    virtual ThreadPool *workers() const { return nullptr; }
+
+    // Whether giving slot the values of s would move it in the view for key
+    bool movesIn(SortKey key, size_t slot, const Student &s) const
+    {
+        switch (key)
+        {
+        case SortKey::NAME:
+            return students.name(slot) != s.name;
+        case SortKey::CLASS_PERCENTAGE:
+            return students.view(slot).studentClass != s.studentClass || students.percentage(slot) != s.percentage;
+        case SortKey::AGE:
+            return students.age(slot) != s.age;
+        default:
+            return false; // roll numbers never change
+        }
+    }
+
+    // Takes slot out of the views that s would move it in, before the row is
+    // overwritten; relist() puts it back into them afterwards
+    uint8_t unlist(size_t slot, const Student &s)
+    {
+        uint8_t moved = 0;
+        for (size_t k = 0; k < views.size(); ++k)
+        {
+            if (views[k] && movesIn(SortKey(k), slot, s))
+            {
+                views[k]->erase(handles.handleOf(slot).index, viewOrder(SortKey(k)));
+                moved |= 1 << k;
+            }
+        }
+        return moved;
+    }
+
+    void relist(size_t slot, uint8_t moved)
+    {
+        for (size_t k = 0; k < views.size(); ++k)
+        {
+            if (moved & (1 << k))
+                views[k]->insert(handles.handleOf(slot).index, viewOrder(SortKey(k)));
+        }
+    }
+
+    // The roster in key order, built on first use with a radix sort and
+    // maintained by every change from then on
+    const SortedView &view(SortKey key) const
+    {
+        unique_ptr<SortedView> &v = views[size_t(key)];
+        if (!v)
+        {
+            if (!handles.built())
+                handles.assign(students.size());
+            // Radix sorts are stable, so sorting by roll first breaks ties the
+            // way RosterSort::before does
+            vector<size_t> order = RosterSort::order(students, SortKey::ROLL, workers());
+            if (key != SortKey::ROLL)
+                order = RosterSort::order(students, key, workers(), &order);
+            vector<uint32_t> sorted(order.size());
+            for (size_t k = 0; k < order.size(); ++k)
+                sorted[k] = handles.handleOf(order[k]).index;
+            v = make_unique<SortedView>();
+            v->assign(sorted);
+        }
+        return *v;
+    }
+
+    // Calls fn(slot) for every student in the current list order
+    template <typename Fn>
+    void forListed(Fn fn) const
+    {
+        if (listOrder == SortKey::COUNT)
+        {
+            for (size_t i = 0; i < students.size(); ++i)
+                fn(i);
+            return;
+        }
+        view(listOrder).forEach([&](uint32_t handle)
+                                { fn(handles.slotAt(handle)); });
+    }
+
+    // Slots in list order for the exporters; empty when that is storage order
+    vector<uint32_t> listedSlots() const
+    {
+        vector<uint32_t> order;
+        if (listOrder != SortKey::COUNT)
+        {
+            order.reserve(students.size());
+            forListed([&](size_t slot)
+                      { order.push_back(slot); });
+        }
+        return order;
+    }
+
+    // New percentages are in the table: drop what was built from the old ones
+    void gradesChanged()
+    {
+        classIndex.clear(); // every total changes; the next class query rebuilds them
+        views[size_t(SortKey::CLASS_PERCENTAGE)].reset();
+        if (published)
+            publishRecords();
+    }
+
+    // Re-applies one journal record during recovery
+    void replayRecord(Journal::RecordType type, string_view payload)
+    {
+        Student s;
+        ByteReader in(payload);
+        int32_t roll = 0;
+        switch (type)
+        {
+        case Journal::ADD:
+        case Journal::UPDATE:
+            if (!Journal::decodeStudent(payload, s))
+                return;
+            gradeCalc->gradeStudent(s);
+            if (type == Journal::ADD)
+                addRecord(s);
+            else
+                updateRecord(s);
+            break;
+        case Journal::DELETE:
+            if (in.get(roll))
+                removeByRoll(roll);
+            break;
+        case Journal::MARKS:
+            if (in.get(roll) && in.get(s.marks[0]) && in.get(s.marks[1]) && in.get(s.marks[2]) &&
+                in.get(s.marks[3]) && in.get(s.marks[4]))
+                setMarks(roll, s.marks);
+            break;
+        case Journal::ATTENDANCE:
+            if (in.get(roll) && in.getString(s.attendance))
+                setAttendance(roll, s.attendance);
+            break;
+        case Journal::ATTENDANCE_DAY:
+        {
+            int32_t day;
+            uint8_t present;
+            if (in.get(roll) && in.get(day) && in.get(present))
+                markDay(roll, day, present);
+            break;
+        }
+        case Journal::SORT:
+        {
+            uint8_t key = 0; // records without a key are sorts by roll number
+            in.get(key);
+            if (key < uint8_t(SortKey::COUNT))
+                listOrder = SortKey(key);
+            break;
+        }
+        }
+    }
+
+    // Saves every journaled change into students.dat, then empties the journal.
+    // Only the segments holding changed records are written.
+    bool checkpoint(FileHandler::SaveStats *report = nullptr)
+    {
+        journal.commit();
+        if (keepSnapshot)
+        {
+            cout << "students.dat could not be read at startup and is not overwritten; "
+                 << "changes are kept in students.journal only.\n";
+            return false;
+        }
+        FileHandler::SnapshotMeta meta;
+        meta.gradingFingerprint = gradeCalc->fingerprint();
+        meta.journalSequence = journal.lastSequence();
+        meta.listOrder = listOrder;
+        meta.attendance = &attendanceLog;
+        FileHandler::SaveStats stats;
+        if (!FileHandler::saveChanges(students, rollIndex, meta, layout, stats))
+            return false;
+        journal.reset();
+        if (report)
+            *report = stats;
+        return true;
+    }
+
+    // Index of the roster by class, built on first use
+    const ClassIndex &classes() const
+    {
+        if (!classIndex.built())
+        {
+            if (!handles.built())
+                handles.assign(students.size());
+            classIndex.build(students, handles);
+        }
+        return classIndex;
+    }
+
+    // Leaderboard of a class, or nullptr if nobody is in it
+    const RankTree *rankingOf(string_view cls) const
+    {
+        classes();
+        const RankTree *ranking = classIndex.rankingOf(students, cls);
+        return ranking && ranking->size() ? ranking : nullptr;
+    }
+
+    void rebuildIndex()
+    {
+        rollIndex.clear();
+        rollIndex.reserve(students.size());
+        for (size_t i = 0; i < students.size(); ++i)
+            rollIndex.insert(students.rollNo(i), i);
+    }
+
+    void regradeAll()
+    {
+        gradeCalc->gradeTable(students);
+        gradesChanged();
+    }
+
+public:
+    StudentOperations(shared_ptr<IGradeCalculator> strategy) // Modified constructor
+        : gradeCalc(move(strategy))
+    {
+    }
+
+    // ---- Changes without prompts ----
+    // Each one applies and logs a single change but does not wait for the
+    // disk; commitChanges() makes everything logged so far durable.
+
+    // Waits until the logged changes are on disk; checkpoints when the journal is large
+    void commitChanges()
+    {
+        journal.commit();
+        if (journal.size() >= CHECKPOINT_BYTES)
+            checkpoint();
+    }
+
+    // Waits until the logged changes are on disk but never checkpoints, for
+    // callers that commit often and call commitChanges() once at the end
+    void syncJournal() { journal.commit(); }
+
+    // Whether commitChanges() would checkpoint
+    bool journalFull() const { return journal.size() >= CHECKPOINT_BYTES; }
+
+    // Grades and adds a student; false if the roll number is taken
+    bool applyAdd(Student &s)
+    {
+        gradeCalc->gradeStudent(s); // Use interface
+        if (!addRecord(s))
+            return false;
+        journal.appendStudent(Journal::ADD, s);
+        return true;
+    }
+
+    // Grades s and stores it over the student with its roll number
+    bool applyUpdate(Student &s)
+    {
+        gradeCalc->gradeStudent(s); // Use interface
+        if (!updateRecord(s))
+            return false;
+        journal.appendStudent(Journal::UPDATE, s);
+        return true;
+    }
+
+    bool applyDelete(int roll)
+    {
+        if (!removeByRoll(roll))
+            return false;
+        journal.append(Journal::DELETE, Journal::encodeRoll(roll));
+        return true;
+    }
+
+    // Returns the new grade, or 0 if the student does not exist
+    char applyMarks(int roll, const float marks[5])
+    {
+        char grade = setMarks(roll, marks);
+        if (grade)
+            journal.append(Journal::MARKS, Journal::encodeMarks(roll, marks));
+        return grade;
+    }
+
+    // Marks a student present or absent on day (see AttendanceLog::dayOf)
+    bool applyAttendance(int roll, bool present, int32_t day)
+    {
+        if (!markDay(roll, day, present))
+            return false;
+        journal.append(Journal::ATTENDANCE_DAY, Journal::encodeAttendanceDay(roll, day, present));
+        return true;
+    }
+
+    // ---- Queries without prompts ----
+
+    // Starts keeping a copy of every record that findPublished() can read from
+    // any thread without a lock; from then on every change republishes its record
+    void publishRecords()
+    {
+        if (!published)
+            published = make_unique<RecordDirectory>();
+        for (size_t i = 0; i < students.size(); ++i)
+            published->put(students.get(i));
+    }
+
+    // Safe to call while another thread changes the roster, once publishRecords() has run
+    bool findPublished(int roll, Student &s) const { return published && published->find(roll, s); }
+
+    // Builds what queries would otherwise build on first use, so that readers
+    // running side by side never have to
+    void warmIndexes() const
+    {
+        classes();
+        if (listOrder != SortKey::COUNT)
+            view(listOrder);
+    }
+
+    // Copies the student with this roll number into s
+    bool find(int roll, Student &s) const
+    {
+        size_t slot = findSlot(roll);
+        if (slot == RollIndex::npos)
+            return false;
+        s = students.get(slot);
+        return true;
+    }
+
+    size_t count() const { return students.size(); }
+
+    // Lowest and highest roll number ({0, 0} for an empty roster)
+    pair<int, int> rollRange() const
+    {
+        if (students.size() == 0)
+            return {0, 0};
+        int low = students.rollNo(0), high = low;
+        for (size_t i = 1; i < students.size(); ++i)
+        {
+            low = min(low, students.rollNo(i));
+            high = max(high, students.rollNo(i));
+        }
+        return {low, high};
+    }
+
+    // Running totals of a class (all zero for an unknown class)
+    ClassIndex::Stats classStats(string_view cls) const { return classes().statsOf(cls); }
+
+    vector<string> classNames() const
+    {
+        const ClassIndex &index = classes();
+        vector<string> names;
+        for (uint32_t id = 0; id < index.classCount(); ++id)
+            names.emplace_back(index.className(id));
+        return names;
+    }
+
+    // ---- Menu operations ----
+
+    virtual void addStudent()
+    {
+        Student s;
+        cout << "Enter name: ";
+        cin.ignore();
+        getline(cin, s.name);
+        cout << "Enter roll number: ";
+        cin >> s.rollNo;
+        if (findSlot(s.rollNo) != RollIndex::npos)
+        {
+            cout << "A student with roll number " << s.rollNo << " already exists.\n";
+            return;
+        }
+        cout << "Enter class: ";
+        cin.ignore();
+        getline(cin, s.studentClass);
+        cout << "Enter age: ";
+        cin >> s.age;
+        cout << "Enter gender: ";
+        cin.ignore();
+        getline(cin, s.gender);
+
+        applyAdd(s);
+        commitChanges();
+        cout << "Student added successfully.\n";
+    }
+
+    virtual void viewAllStudents() const
+    {
+        cout << left << setw(10) << "Roll" << setw(20) << "Name" << setw(10) << "Class"
+             << setw(6) << "Age" << setw(10) << "Gender" << setw(10) << "Percentage"
+             << setw(8) << "Grade" << "Attendance\n";
+
+        forListed([&](size_t i)
+                  {
+                      StudentView s = students.view(i);
+                      cout << setw(10) << s.rollNo << setw(20) << s.name << setw(10) << s.studentClass
+                           << setw(6) << s.age << setw(10) << s.gender << setw(10) << fixed
+                           << setprecision(2) << s.percentage << setw(8) << s.grade << s.attendance << "\n"; });
+    }
+
+    virtual void searchStudent() const
+    {
+        int roll;
+        cout << "Enter roll number: ";
+        cin >> roll;
+
+        size_t slot = findSlot(roll);
+        if (slot != RollIndex::npos)
+        {
+            StudentView s = students.view(slot);
+            cout << "\nStudent Details:\n"
+                 << "Name: " << s.name << "\n"
+                 << "Class: " << s.studentClass << "\n"
+                 << "Age: " << s.age << "\n"
+                 << "Gender: " << s.gender << "\n"
+                 << "Percentage: " << s.percentage << "%\n"
+                 << "Grade: " << s.grade << "\n";
+        }
+        else
+        {
+            cout << "Student not found.\n";
+        }
+    }
+
+    virtual void updateStudent()
+    {
+        int roll;
+        cout << "Enter roll number to update: ";
+        cin >> roll;
+
+        size_t slot = findSlot(roll);
+        if (slot != RollIndex::npos)
+        {
+            Student s = students.get(slot);
+            cout << "Enter new name: ";
+            cin.ignore();
+            getline(cin, s.name);
+            cout << "Enter new class: ";
+            getline(cin, s.studentClass);
+            cout << "Enter new age: ";
+            cin >> s.age;
+            cout << "Enter new gender: ";
+            cin.ignore();
+            getline(cin, s.gender);
+
+            applyUpdate(s);
+            commitChanges();
+            cout << "Student updated successfully.\n";
+        }
+        else
+        {
+            cout << "Student not found.\n";
+        }
+    }
+
+    virtual void deleteStudent()
+    {
+        int roll;
+        cout << "Enter roll number to delete: ";
+        cin >> roll;
+
+        if (applyDelete(roll))
+        {
+            commitChanges();
+            cout << "Student deleted successfully.\n";
+        }
+        else
+        {
+            cout << "Student not found.\n";
+        }
+    }
+
+    // Chooses the order View All and the exports list the roster in. The
+    // table itself is not reordered: each order is a view that, once built,
+    // follows every change, so choosing it again costs nothing.
+    virtual void sortStudents()
+    {
+        static const char *const orders[] = {"roll number", "name", "class and percentage", "age"};
+        int choice;
+        cout << "Sort by:\n1. Roll number\n2. Name\n3. Class, then percentage\n4. Age\nEnter choice: ";
+        cin >> choice;
+        if (choice < 1 || choice > int(SortKey::COUNT))
+        {
+            cout << "Invalid choice.\n";
+            return;
+        }
+
+        SortKey key = SortKey(choice - 1);
+        bool built = views[size_t(key)] != nullptr;
+        auto start = chrono::steady_clock::now();
+        view(key);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        listOrder = key;
+        string payload;
+        ByteWriter(payload).put(uint8_t(key));
+        journal.append(Journal::SORT, payload);
+        commitChanges();
+
+        // Other reports print with whatever precision they find, so leave it as it was
+        ios::fmtflags flags = cout.flags();
+        streamsize precision = cout.precision();
+        cout << "Students sorted by " << orders[choice - 1];
+        if (built)
+            cout << " (view already up to date).\n";
+        else
+            cout << " (view built in " << fixed << setprecision(1) << seconds * 1000 << " ms).\n";
+        cout.flags(flags);
+        cout.precision(precision);
+
+        if (verifyStats)
+        {
+            vector<size_t> order = RosterSort::order(students, SortKey::ROLL);
+            if (key != SortKey::ROLL)
+                order = RosterSort::order(students, key, nullptr, &order);
+            vector<uint32_t> listed = listedSlots();
+            if (equal(order.begin(), order.end(), listed.begin(), listed.end()))
+                cout << "Verified against a full sort.\n";
+            else
+                cout << "Warning: the " << orders[choice - 1] << " view disagrees with a full sort.\n";
+        }
+    }
+
+    void saveData()
+    {
+        FileHandler::SaveStats stats;
+        if (checkpoint(&stats))
+        {
+            cout << "Data saved successfully: " << stats.changedRows << " changed records, "
+                 << stats.segmentsWritten << " of " << stats.segments << " segments written"
+                 << (stats.rewritten ? " (full rewrite), " : ", ") << stats.bytesWritten << " bytes.\n";
+        }
+    }
+
+    // Maps students.dat (falling back to a legacy students.txt the first time),
+    // then replays whatever the journal recorded after that snapshot
     void loadData()
     {
-        students = FileHandler::loadFromFile();
-        for (auto &s : students)
+        students.clear();
+        rollIndex.clear();
+        classIndex.clear();
+        handles.clear();
+        published.reset(); // nothing reads it while the roster is loaded
+        for (auto &v : views)
+            v.reset();
+        listOrder = SortKey::COUNT;
+        layout = FileHandler::SnapshotLayout();
+        keepSnapshot = false;
+        attendanceLog.clear();
+        FileHandler::SnapshotMeta meta;
+        meta.attendance = &attendanceLog;
+        bool replayJournal = true;
+        if (ifstream("students.dat") && !FileHandler::mapSnapshot("students.dat", students, rollIndex, meta, &layout))
+        {
+            // Nothing in the journal applies to an empty roster. The unreadable
+            // snapshot and its journal are moved aside so that saving the new
+            // roster destroys neither; if they cannot be, students.dat is never
+            // saved over and new changes go after the old journal records.
+            students.clear();
+            rollIndex.clear();
+            attendanceLog.clear();
+            layout = FileHandler::SnapshotLayout();
+            meta.journalSequence = 0;
+            replayJournal = false;
+            bool journaled = bool(ifstream("students.journal"));
+            if (rename("students.dat", "students.dat.corrupt") == 0 &&
+                (!journaled || rename("students.journal", "students.journal.corrupt") == 0))
+            {
+                cout << "Warning: moved students.dat" << (journaled ? " and students.journal" : "")
+                     << " aside (.corrupt); starting with an empty roster.\n";
+            }
+            else
+            {
+                keepSnapshot = true;
+                cout << "Warning: students.dat could not be moved aside (" << strerror(errno)
+                     << "); starting with an empty roster that will not be saved over it.\n";
+            }
+        }
+        else if (ifstream("students.dat"))
+        {
+            listOrder = meta.listOrder;
+            if (rollIndex.size() != students.size())
+                rebuildIndex();
+            // Stored percentages and grades are current unless the grading policy
+            // changed; a policy switched to at run time stays in force
+            if (meta.gradingFingerprint != gradeCalc->fingerprint())
+            {
+                auto policies = gradingPolicies();
+                auto stored = find_if(policies.begin(), policies.end(), [&](const GradingPolicy &p)
+                                      { return p.calculator->fingerprint() == meta.gradingFingerprint; });
+                if (stored != policies.end())
+                    gradeCalc = stored->calculator;
+                else
+                    regradeAll();
+            }
+        }
+        else
+        {
+            // Sized once from the file, so the load itself allocates nothing per record
+            size_t expected = CsvReader::estimateRows("students.txt");
+            students.reserve(expected, FileHandler::textBytes("students.txt"));
+            rollIndex.reserve(expected);
+            size_t duplicates = 0;
+            FileHandler::loadFromFile("students.txt", [&](Student &s)
+                                      {
+                                          gradeCalc->calculateGrade(s); // Use interface
+                                          if (!addRecord(s))
+                                              ++duplicates; });
+            if (duplicates)
+                cout << "Warning: skipped " << duplicates << " records with duplicate roll numbers.\n";
+        }
+
+        // A journal that is not replayed is still read through, so new changes
+        // are numbered after its last record rather than from a made-up sequence
+        auto recovered = Journal::replay("students.journal", meta.journalSequence,
+                                         [this, replayJournal](Journal::RecordType type, string_view payload)
+                                         {
+                                             if (replayJournal)
+                                                 replayRecord(type, payload);
+                                         });
+        if (recovered.records && replayJournal)
+        {
+            cout << "Recovered " << recovered.records << " changes from students.journal in "
+                 << fixed << setprecision(1) << recovered.seconds * 1000 << " ms ("
+                 << setprecision(0) << recovered.records / max(recovered.seconds, 1e-9)
+                 << " records/sec)\n";
+        }
+        if (recovered.torn)
+            cout << "Warning: ignored a damaged record at the end of students.journal.\n";
+        journal.open("students.journal", recovered.validBytes, recovered.lastSequence);
+    }
+};
+
+// ==================== Extended Functionality ====================
+
+class ExtendedStudentOperations : public StudentOperations
+{
+    shared_ptr<IExporter> exporter;
+    shared_ptr<IReportGenerator> reportGenerator;
+    shared_ptr<ThreadPool> pool; // bulk work such as CSV imports
+
+    // A regrade under a new policy, running on the pool. The new percentages
+    // and grades go to side buffers while the table keeps serving the old ones.
+    struct PendingRegrade
+    {
+        GradingPolicy policy;
+        vector<float> percentage; // by slot
+        vector<char> grade;
+        vector<future<void>> parts;
+        chrono::steady_clock::time_point started;
+    };
+    unique_ptr<PendingRegrade> regrade;
+
+protected:
+    ThreadPool *workers() const override { return pool.get(); }
+
+public:
+    ExtendedStudentOperations(shared_ptr<IGradeCalculator> gradeStrategy, // Use IGradeCalculator
+                              shared_ptr<IExporter> exp,
+                              shared_ptr<IReportGenerator> repGen,
+                              shared_ptr<ThreadPool> workers)
+        : StudentOperations(move(gradeStrategy)),
+          exporter(move(exp)),
+          reportGenerator(move(repGen)),
+          pool(move(workers))
+    {
+    }
+
+    ~ExtendedStudentOperations()
+    {
+        // The workers read the table; let them finish before it goes away
+        if (regrade)
+        {
+            for (auto &part : regrade->parts)
+                part.wait();
+        }
+    }
+
+    void setVerifyStats(bool on) { verifyStats = on; }
+
+    // Switches the grading policy. The roster is regraded in the background;
+    // until that finishes, reads see the old grades, and publishRegrade()
+    // swaps the new ones in all at once.
+    void changeGradingPolicy()
+    {
+        publishRegrade(true);
+        auto policies = gradingPolicies();
+        cout << "Grading policies:\n";
+        for (size_t i = 0; i < policies.size(); ++i)
+        {
+            cout << i + 1 << ". " << policies[i].name
+                 << (policies[i].calculator->fingerprint() == gradeCalc->fingerprint() ? " (current)" : "") << "\n";
+        }
+        size_t choice;
+        cout << "Choose policy: ";
+        cin >> choice;
+        if (choice < 1 || choice > policies.size())
+        {
+            cout << "Invalid choice.\n";
+            return;
+        }
+        if (policies[choice - 1].calculator->fingerprint() == gradeCalc->fingerprint())
+        {
+            cout << "The " << policies[choice - 1].name << " policy is already in use.\n";
+            return;
+        }
+
+        auto job = make_unique<PendingRegrade>();
+        job->policy = policies[choice - 1];
+        job->percentage.resize(students.size());
+        job->grade.resize(students.size());
+        job->started = chrono::steady_clock::now();
+        size_t segments = students.segmentCount();
+        size_t perPart = max<size_t>(1, segments / (pool->size() * 4));
+        for (size_t from = 0; from < segments; from += perPart)
+        {
+            size_t to = min(segments, from + perPart);
+            job->parts.push_back(pool->submit([this, job = job.get(), from, to]
+                                              {
+                                                  for (size_t k = from; k < to; ++k)
+                                                  {
+                                                      const float *marks[5];
+                                                      students.segmentMarks(k, marks);
+                                                      size_t first = k * StudentTable::SEGMENT_ROWS, rows = students.segmentRows(k);
+                                                      copy_n(students.segmentPercentages(k), rows, &job->percentage[first]);
+                                                      job->policy.calculator->gradeRows(marks, &job->percentage[first],
+                                                                                        &job->grade[first], rows);
+                                                  } }));
+        }
+        regrade = move(job);
+        cout << "Regrading " << students.size() << " students under the " << regrade->policy.name
+             << " policy on " << pool->size() << (pool->size() == 1 ? " thread" : " threads")
+             << "; current grades stay in use until it finishes.\n";
+    }
+
+    // Makes a finished regrade visible: copies the new grades in, switches the
+    // calculator and saves. With wait, blocks until the regrade is done (for
+    // anything that changes the roster); otherwise only publishes if it is.
+    void publishRegrade(bool wait)
+    {
+        if (!regrade)
+            return;
+        if (!wait)
+        {
+            for (auto &part : regrade->parts)
+            {
+                if (part.wait_for(chrono::seconds(0)) != future_status::ready)
+                    return;
+            }
+        }
+        for (auto &part : regrade->parts)
+            part.get();
+
+        size_t first = 0;
+        students.updateGrades([&](const float *const[5], float *percentage, char *grade, size_t rows)
+                              {
+                                  copy_n(&regrade->percentage[first], rows, percentage);
+                                  copy_n(&regrade->grade[first], rows, grade);
+                                  first += rows; });
+        gradeCalc = regrade->policy.calculator;
+        gradesChanged();
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - regrade->started).count();
+        cout << "Grading policy is now " << regrade->policy.name << ": regraded " << students.size()
+             << " students in " << fixed << setprecision(2) << seconds << " s.\n";
+        regrade.reset();
+        // The snapshot records the policy, so the journal never mixes two of them
+        if (!checkpoint())
+            cout << "Warning: new grades could not be saved yet; use Save & Exit to retry.\n";
+    }
+
+    // Reads a date for a prompt; false (after saying so) if it is not one
+    static bool readDate(const char *prompt, int32_t &day)
+    {
+        string text;
+        cout << prompt << " (YYYY-MM-DD or today): ";
+        cin >> text;
+        if (AttendanceLog::parseDate(text, day))
+            return true;
+        cout << "Invalid date: " << text << "\n";
+        return false;
+    }
+
+    static bool readRange(int32_t &from, int32_t &to)
+    {
+        if (!readDate("From", from) || !readDate("To", to))
+            return false;
+        if (from > to)
+            swap(from, to);
+        return true;
+    }
+
+    void markAttendance()
+    {
+        int32_t day;
+        if (!readDate("Enter date", day))
+            return;
+        for (size_t i = 0; i < students.size(); ++i)
+        {
+            cout << "Mark attendance for " << students.name(i) << " (P/A): ";
+            char a;
+            cin >> a;
+            applyAttendance(students.rollNo(i), toupper(a) == 'P', day);
+        }
+        commitChanges(); // one sync for the whole register
+    }
+
+    // Queries over the day-by-day history; none of them reads the roster rows
+    void showAttendanceHistory() const
+    {
+        cout << "1. Student attendance rate\n2. Students below an attendance threshold\n"
+             << "3. Daily absences per class\nChoose query: ";
+        int choice;
+        cin >> choice;
+        if (choice < 1 || choice > 3)
+        {
+            cout << "Invalid choice.\n";
+            return;
+        }
+
+        if (choice == 1)
+        {
+            int roll;
+            cout << "Enter roll number: ";
+            cin >> roll;
+            size_t slot = findSlot(roll);
+            if (slot == RollIndex::npos)
+            {
+                cout << "Student not found.\n";
+                return;
+            }
+            int32_t from, to;
+            if (!readRange(from, to))
+                return;
+            AttendanceLog::Rate rate = attendanceLog.rateOf(roll, from, to);
+            if (rate.marked == 0)
+            {
+                cout << students.name(slot) << " was not marked between " << AttendanceLog::formatDate(from)
+                     << " and " << AttendanceLog::formatDate(to) << ".\n";
+                return;
+            }
+            cout << students.name(slot) << ": present " << rate.present << " of " << rate.marked << " days ("
+                 << fixed << setprecision(1) << 100.0 * rate.present / rate.marked << "%)\n";
+        }
+        else if (choice == 2)
+        {
+            int32_t from, to;
+            if (!readRange(from, to))
+                return;
+            unsigned percent;
+            cout << "Threshold percentage (e.g. 75): ";
+            cin >> percent;
+            auto started = chrono::steady_clock::now();
+            vector<int> rolls = attendanceLog.below(from, to, min(percent, 100u));
+            double seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+            cout << rolls.size() << " students below " << min(percent, 100u) << "% attendance ("
+                 << fixed << setprecision(2) << seconds * 1000 << " ms):\n";
+            for (int roll : rolls)
+            {
+                size_t slot = findSlot(roll);
+                if (slot == RollIndex::npos)
+                    continue;
+                AttendanceLog::Rate rate = attendanceLog.rateOf(roll, from, to);
+                cout << left << setw(20) << students.name(slot) << right << setw(8) << roll << "  "
+                     << rate.present << "/" << rate.marked << "\n";
+            }
+        }
+        else
+        {
+            string cls;
+            cout << "Enter class (* for all): ";
+            cin >> cls;
+            int32_t from, to;
+            if (!readRange(from, to))
+                return;
+            size_t shown = 0;
+            cout << left << setw(12) << "Date" << setw(10) << "Class" << right << setw(10) << "Absent"
+                 << setw(10) << "Present" << "\n";
+            attendanceLog.forRegisters(from, to, [&](int32_t day, string_view name, const AttendanceLog::Register &r)
+                                       {
+                                           if (cls != "*" && name != cls)
+                                               return;
+                                           cout << left << setw(12) << AttendanceLog::formatDate(day) << setw(10) << name
+                                                << right << setw(10) << r.absent.cardinality()
+                                                << setw(10) << r.present.cardinality() << "\n";
+                                           ++shown; });
+            if (!shown)
+                cout << "No attendance was marked in that range.\n";
+        }
+    }
+
+    void enterMarks()
+    {
+        int roll;
+        cout << "Enter roll number: ";
+        cin >> roll;
+
+        if (findSlot(roll) != RollIndex::npos)
+        {
+            float marks[5];
+            cout << "Enter marks for 5 subjects (space separated): ";
+            for (int i = 0; i < 5; ++i)
+            {
+                cin >> marks[i];
+            }
+            char grade = applyMarks(roll, marks);
+            commitChanges();
+            cout << "Marks updated. New grade: " << grade << "\n";
+        }
+        else
+        {
+            cout << "Student not found.\n";
+        }
+    }
+
+    void calculateGPA() const
+    {
+        for (size_t i = 0; i < students.size(); ++i)
+        {
+            cout << students.name(i) << ": GPA = " << fixed << setprecision(2)
+                 << (students.percentage(i) / 20.0) << "\n";
+        }
+    }
+
+    void generateClassReport() const
+    {
+        reportGenerator->generateReport(*students.snapshot(), classes());
+    }
+
+    void writeClassReport(string_view cls, ostream &out) const { classReportJob(cls, out)(); }
+
+    void exportData() const
+    {
+        string filename;
+        cout << "Enter export filename (blank for students.csv): ";
+        cin.ignore();
+        getline(cin, filename);
+        exportTo(filename.empty() ? "students.csv" : filename);
+    }
+
+    // CSV export in the current list order
+    void exportTo(const string &filename) const { exportJob(filename)(); }
+
+    void backupData() const
+    {
+        time_t now = time(nullptr);
+        char buffer[80];
+        strftime(buffer, sizeof(buffer), "backup_%Y%m%d_%H%M%S.dat", localtime(&now));
+        string filename = buffer;
+        if (backupJob(filename)())
+            cout << "Backup created successfully: " << filename << "\n";
+    }
+
+    // ---- Reads from a snapshot ----
+    // Each job pins the roster and copies what it needs from the indexes when
+    // it is made, which has to happen with changes excluded. Running it needs
+    // no lock, so a long report or export never holds up changes and never
+    // sees one half done.
+
+    function<void()> classReportJob(string_view cls, ostream &out) const
+    {
+        return [this, snapshot = students.snapshot(), slots = classes().slotsOf(cls), cls = string(cls), &out]
+        { reportGenerator->writeReport(*snapshot, slots, cls, out); };
+    }
+
+    function<void()> exportJob(const string &filename) const
+    {
+        return [this, snapshot = students.snapshot(), order = listedSlots(), filename]
+        { exporter->exportData(*snapshot, order, filename); };
+    }
+
+    // A complete snapshot file, as students.dat would be after a save
+    function<bool()> backupJob(const string &filename) const
+    {
+        auto index = make_shared<RollIndex>();
+        index->adopt(vector<RollIndex::Entry>(rollIndex.entries(), rollIndex.entries() + rollIndex.tableSize()),
+                     rollIndex.size());
+        FileHandler::SnapshotMeta meta;
+        meta.gradingFingerprint = gradeCalc->fingerprint();
+        meta.journalSequence = journal.lastSequence();
+        meta.listOrder = listOrder;
+        auto history = make_shared<AttendanceLog>(attendanceLog);
+        meta.attendance = history.get();
+        return [snapshot = students.snapshot(), index, history, meta, filename]
+        { return FileHandler::saveSnapshot(*snapshot, *index, meta, filename); };
+    }
+
+    void exportTextFile() const
+    {
+        string filename;
+        cout << "Enter text filename to export (e.g. students.txt): ";
+        cin >> filename;
+        FileHandler::saveToFile(students, filename, listedSlots());
+        cout << "Exported " << students.size() << " students to " << filename << "\n";
+    }
+
+    // Both importers journal every row like any other add, so one group-commit
+    // sync makes an import durable and a crash replays it; a large import is
+    // then folded into students.dat by the usual checkpoint
+    void commitImport()
+    {
+        if (!journal.commit())
+        {
+            cout << "Warning: imported rows could not be journaled and are not durable yet; "
+                 << "use Save & Exit to retry.\n";
+            return;
+        }
+        if (journalFull() && !checkpoint())
+            cout << "Warning: imported rows are only in students.journal until the next save.\n";
+    }
+
+    void importTextFile()
+    {
+        string filename;
+        cout << "Enter text filename to import: ";
+        cin >> filename;
+        if (!ifstream(filename))
+        {
+            cout << "Failed to open file: " << filename << "\n";
+            return;
+        }
+
+        size_t added = 0, duplicates = 0;
+        size_t expected = students.size() + CsvReader::estimateRows(filename);
+        students.reserve(expected, FileHandler::textBytes(filename));
+        rollIndex.reserve(expected);
+        FileHandler::loadFromFile(filename, [&](Student &s)
+                                  {
+                                      gradeCalc->calculateGrade(s);
+                                      if (addRecord(s))
+                                      {
+                                          journal.appendStudent(Journal::ADD, s);
+                                          ++added;
+                                      }
+                                      else
+                                      {
+                                          ++duplicates;
+                                      } });
+        commitImport();
+        cout << "Imported " << added << " students from " << filename << "\n";
+        if (duplicates)
+            cout << "Skipped " << duplicates << " records with roll numbers already on the roster.\n";
+    }
+
+    // Feature 2: Student Statistics
+    void showStatistics() const
+    {
+        string cls;
+        cout << "Enter class for statistics: ";
+        cin >> cls;
+
+        // Running totals: O(1) however large the class is, and copied so they
+        // hold still while they are printed
+        ClassIndex::Stats stats = classes().statsOf(cls);
+        if (stats.count == 0)
+        {
+            cout << "No students found in class " << cls << "\n";
+            return;
+        }
+
+        cout << "\nClass " << cls << " Statistics:\n";
+        cout << "Total Students: " << stats.count << "\n";
+        cout << "Average Percentage: " << fixed << setprecision(2) << stats.average() << "%\n";
+        cout << "Standard Deviation: " << stats.deviation() << "%\n";
+        cout << "Subject Averages:";
+        for (double sum : stats.subjectSums)
+            cout << " " << (stats.marked ? sum / stats.marked : 0.0);
+        cout << "\nGrade Distribution:\n";
+        for (int grade = 0; grade < 128; ++grade)
+        {
+            if (stats.grades[grade])
+                cout << "Grade " << char(grade) << ": " << stats.grades[grade] << " students\n";
+        }
+
+        if (verifyStats)
+        {
+            if (ClassIndex::agree(stats, classIndex.recompute(students, cls)))
+                cout << "Verified against a full recompute.\n";
+            else
+                cout << "Warning: running statistics for class " << cls << " disagree with a full recompute.\n";
+        }
+    }
+
+    void importFromCSV()
+    {
+        string filename;
+        cout << "Enter CSV filename to import: ";
+        cin.ignore();
+        getline(cin, filename);
+
+        if (!ifstream(filename))
+        {
+            cout << "Failed to open file: " << filename << "\n";
+            return;
+        }
+
+        size_t expected = students.size() + CsvReader::estimateRows(filename);
+        students.reserve(expected);
+        rollIndex.reserve(expected);
+
+        // Parsing runs on the workers; adding to the roster (and spotting
+        // duplicate roll numbers) happens on this thread in file order
+        auto parseRow = [this](const vector<string_view> &field, Student &s)
+        {
+            // Roll,Name,Class,Age,Gender,Percentage,Grade,Attendance
+            if (field.size() != 8 || !CsvReader::parse(field[0], s.rollNo) ||
+                !CsvReader::parse(field[3], s.age) || !CsvReader::parse(field[5], s.percentage))
+                return false;
+            s.name.assign(field[1]);
+            s.studentClass.assign(field[2]);
+            s.gender.assign(field[4]);
+            s.attendance.assign(field[7]);
+            // The CSV has no per-subject marks: they stay unset and the
+            // percentage is kept as imported
+            s.grade = gradeCalc->gradeFor(s.percentage); // Recalculate to ensure consistency
+            return true;
+        };
+        size_t added = 0, duplicates = 0;
+        auto mergeRow = [&](const Student &s)
+        {
+            if (addRecord(s))
+            {
+                journal.appendStudent(Journal::ADD, s);
+                ++added;
+            }
+            else
+            {
+                ++duplicates;
+            }
+        };
+
+        CsvReader::Stats stats;
+        bool read;
+        if (pool->size() > 1)
+        {
+            read = CsvReader::forEachRecord<Student>(filename, *pool, parseRow, mergeRow, stats);
+        }
+        else
+        {
+            Student s; // reused for every row so its strings keep their capacity
+            read = CsvReader::forEachRow(filename, [&](const vector<string_view> &field)
+                                         {
+                                             if (!parseRow(field, s))
+                                                 return false;
+                                             mergeRow(s);
+                                             return true; }, stats);
+        }
+        commitImport(); // rows added before a read error stay, like any other change
+        if (!read)
+        {
+            cout << "Failed to read file: " << filename << "\n";
+            return;
+        }
+
+        double seconds = max(stats.seconds, 1e-9);
+        cout << "Data imported successfully from " << filename << ": " << added << " students in "
+             << fixed << setprecision(2) << stats.seconds << " s (" << setprecision(0)
+             << stats.rows / seconds << " rows/sec, " << setprecision(1)
+             << stats.bytes / seconds / (1 << 20) << " MB/s, " << pool->size()
+             << (pool->size() == 1 ? " thread)\n" : " threads)\n");
+        if (duplicates)
+            cout << "Skipped " << duplicates << " rows with roll numbers already on the roster.\n";
+        if (stats.malformed)
+            cout << "Skipped " << stats.malformed << " malformed rows (first at data row "
+                 << stats.firstMalformedRow << ").\n";
+    }
+
+    // Feature 3: Find Topper
+    void findTopper() const
+    {
+        string cls;
+        cout << "Enter class to find topper: ";
+        cin >> cls;
+
+        // Best percentage first; ties go to the lower roll number
+        const RankTree *ranking = rankingOf(cls);
+        if (ranking)
+        {
+            ranking->forRanks(0, 1, [&](float, int roll)
+                              {
+                                  StudentView s = students.view(findSlot(roll));
+                                  cout << "Topper of class " << cls << ":\n";
+                                  cout << "Name: " << s.name << "\n";
+                                  cout << "Roll No: " << s.rollNo << "\n";
+                                  cout << "Percentage: " << fixed << setprecision(2) << s.percentage << "%\n";
+                                  cout << "Grade: " << s.grade << "\n"; });
+        }
+        else
+        {
+            cout << "No students found in class " << cls << "\n";
+        }
+    }
+
+    void printRanked(const RankTree &ranking, size_t from, size_t count) const
+    {
+        cout << left << setw(6) << "Rank" << setw(10) << "Roll" << setw(20) << "Name"
+             << setw(12) << "Percentage" << "Grade\n";
+        size_t rank = from;
+        ranking.forRanks(from, count, [&](float percentage, int roll)
+                         { cout << setw(6) << ++rank << setw(10) << roll << setw(20)
+                                << students.name(findSlot(roll)) << setw(12) << fixed << setprecision(2)
+                                << percentage << students.grade(findSlot(roll)) << "\n"; });
+    }
+
+    // What-if report: grades every student under each policy in one pass over
+    // the mark columns (percentages once per segment, then each policy's
+    // grades with the vector kernels) and counts, per class, how each stored
+    // grade would change. Nothing stored is modified.
+    void compareGradingPolicies() const
+    {
+        string cls;
+        cout << "Enter class to compare (* for all classes): ";
+        cin >> cls;
+
+        auto started = chrono::steady_clock::now();
+        auto policies = gradingPolicies();
+        const ClassIndex &index = classes();
+        if (cls != "*" && index.find(cls) == ClassIndex::npos)
+        {
+            cout << "No students found in class " << cls << "\n";
+            return;
+        }
+
+        // Letters any policy can give; anything else stored is counted as '?'
+        set<char> seen;
+        for (const auto &policy : policies)
+        {
+            for (int step = -100; step <= 10100; ++step)
+                seen.insert(policy.strategy->calculateGrade(step / 100.0f));
+        }
+        string letters(seen.begin(), seen.end());
+        letters += '?';
+        uint8_t letterIndex[128];
+        fill(begin(letterIndex), end(letterIndex), letters.size() - 1);
+        for (size_t l = 0; l + 1 < letters.size(); ++l)
+            letterIndex[letters[l] & 0x7f] = l;
+
+        const size_t L = letters.size(), N = policies.size(), C = index.classCount();
+        auto cell = [=](size_t c, size_t n, size_t from, size_t to)
+        { return ((c * N + n) * L + from) * L + to; };
+
+        // Each part counts into its own matrices; they are summed at the end
+        size_t segments = students.segmentCount();
+        size_t perPart = max<size_t>(1, segments / (pool->size() * 4));
+        vector<future<vector<uint32_t>>> parts;
+        for (size_t from = 0; from < segments; from += perPart)
+        {
+            size_t to = min(segments, from + perPart);
+            parts.push_back(pool->submit([&, from, to]
+                                         {
+                                             vector<uint32_t> counts(C * N * L * L);
+                                             float percentage[StudentTable::SEGMENT_ROWS];
+                                             char grade[StudentTable::SEGMENT_ROWS];
+                                             uint8_t stored[StudentTable::SEGMENT_ROWS];
+                                             for (size_t k = from; k < to; ++k)
+                                             {
+                                                 const float *marks[5];
+                                                 students.segmentMarks(k, marks);
+                                                 size_t rows = students.segmentRows(k), first = k * StudentTable::SEGMENT_ROWS;
+                                                 GradeKernels::sumMarks(marks, percentage, rows);
+                                                 for (size_t i = 0; i < rows; ++i)
+                                                     stored[i] = letterIndex[students.grade(first + i) & 0x7f];
+                                                 for (size_t n = 0; n < N; ++n)
+                                                 {
+                                                     GradeCutoffs cutoffs;
+                                                     if (policies[n].strategy->describeCutoffs(cutoffs) && cutoffs.count <= GradeCutoffs::MAX_CUTOFFS)
+                                                     {
+                                                         GradeKernels::gradeByCutoffs(cutoffs, percentage, grade, rows);
+                                                     }
+                                                     else
+                                                     {
+                                                         for (size_t i = 0; i < rows; ++i)
+                                                             grade[i] = policies[n].strategy->calculateGrade(percentage[i]);
+                                                     }
+                                                     for (size_t i = 0; i < rows; ++i)
+                                                         ++counts[cell(index.classOf(first + i), n, stored[i], letterIndex[grade[i] & 0x7f])];
+                                                 }
+                                             }
+                                             return counts; }));
+        }
+        vector<uint32_t> counts(C * N * L * L);
+        for (auto &part : parts)
+        {
+            vector<uint32_t> partial = part.get();
+            for (size_t i = 0; i < counts.size(); ++i)
+                counts[i] += partial[i];
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+
+        cout << "What-if grading of " << students.size() << " students under " << N << " policies in "
+             << fixed << setprecision(1) << seconds * 1000 << " ms\n";
+        for (size_t c = 0; c < C; ++c)
+        {
+            if (cls != "*" && index.className(c) != cls)
+                continue;
+            auto total = [&](size_t n, size_t l, bool stored)
+            {
+                uint64_t sum = 0;
+                for (size_t other = 0; other < L; ++other)
+                    sum += stored ? counts[cell(c, n, l, other)] : counts[cell(c, n, other, l)];
+                return sum;
+            };
+            uint64_t members = 0;
+            for (size_t l = 0; l < L; ++l)
+                members += total(0, l, true);
+            if (members == 0)
+                continue; // every student has left this class
+            // The '?' row only matters if some stored grade is not a policy letter
+            size_t shown = total(0, L - 1, true) ? L : L - 1;
+
+            cout << "\nClass " << index.className(c) << ":\n" << left << setw(8) << "Grade" << right << setw(10) << "current";
+            for (const auto &policy : policies)
+                cout << setw(10) << policy.name;
+            cout << "\n";
+            for (size_t l = 0; l < shown; ++l)
+            {
+                cout << left << setw(8) << letters[l] << right << setw(10) << total(0, l, true);
+                for (size_t n = 0; n < N; ++n)
+                    cout << setw(10) << total(n, l, false);
+                cout << "\n";
+            }
+            for (size_t n = 0; n < N; ++n)
+            {
+                cout << "Current grade (rows) -> " << policies[n].name << " (columns):\n" << setw(8) << "";
+                for (size_t to = 0; to + 1 < L; ++to)
+                    cout << setw(10) << letters[to];
+                cout << "\n";
+                for (size_t from = 0; from < shown; ++from)
+                {
+                    cout << left << setw(8) << letters[from] << right;
+                    for (size_t to = 0; to + 1 < L; ++to)
+                        cout << setw(10) << counts[cell(c, n, from, to)];
+                    cout << "\n";
+                }
+            }
+        }
+    }
+
+    // Leaderboard: the K best students of a class
+    void showTopStudents() const
+    {
+        string cls;
+        size_t k;
+        cout << "Enter class: ";
+        cin >> cls;
+        cout << "How many students: ";
+        cin >> k;
+
+        const RankTree *ranking = rankingOf(cls);
+        if (!ranking)
+        {
+            cout << "No students found in class " << cls << "\n";
+            return;
+        }
+        cout << "Top " << min(k, ranking->size()) << " of class " << cls << ":\n";
+        printRanked(*ranking, 0, k);
+    }
+
+    // Position of one student within their class
+    void showStudentRank() const
+    {
+        int roll;
+        cout << "Enter roll number: ";
+        cin >> roll;
+
+        size_t slot = findSlot(roll);
+        if (slot == RollIndex::npos)
+        {
+            cout << "Student not found.\n";
+            return;
+        }
+        string_view cls = students.studentClass(slot);
+        const RankTree *ranking = rankingOf(cls);
+        float percentage = students.percentage(slot);
+        size_t rank = ranking->countBefore(percentage, roll) + 1;
+        size_t below = ranking->size() - ranking->countAbove(percentage, true);
+        cout << students.name(slot) << " is ranked " << rank << " of " << ranking->size()
+             << " in class " << cls << " (" << fixed << setprecision(2) << percentage
+             << "%, ahead of " << setprecision(1) << 100.0 * below / ranking->size()
+             << "% of the class)\n";
+    }
+
+    // Students of a class whose percentage lies in [low, high], best first
+    void showPercentageRange() const
+    {
+        string cls;
+        float low, high;
+        cout << "Enter class: ";
+        cin >> cls;
+        cout << "Enter lowest and highest percentage: ";
+        cin >> low >> high;
+
+        const RankTree *ranking = rankingOf(cls);
+        if (!ranking)
         {
-            gradeCalc->calculateGrade(s); // Use interface
+            cout << "No students found in class " << cls << "\n";
+            return;
         }
+        size_t from = ranking->countAbove(high, false);
+        size_t to = ranking->countAbove(low, true);
+        size_t count = to > from ? to - from : 0;
+        cout << count << " students of class " << cls << " between " << fixed << setprecision(2)
+             << low << "% and " << high << "%:\n";
+        if (count)
+            printRanked(*ranking, from, count);
     }
 };
 
-// ==================== Extended Functionality ====================
+// ==================== Batch Mode ====================
 
-class ExtendedStudentOperations : public StudentOperations
+// Runs a script of commands without prompts, for scheduled jobs. One command
+// per line; fields are separated by spaces or tabs, and a field with spaces
+// in it goes in double quotes. Blank lines and lines starting with # are
+// skipped.
+//   add NAME ROLL CLASS AGE GENDER [M1 M2 M3 M4 M5]
+//   update ROLL NAME CLASS AGE GENDER
+//   delete ROLL
+//   marks ROLL M1 M2 M3 M4 M5
+//   attendance ROLL P|A [DATE]      (DATE is YYYY-MM-DD; today if left out)
+//   report CLASS
+//   export [FILE]
+//   save
+// Changes are journaled as they are applied; the journal is synced every
+// COMMIT_CHANGES changes and checkpointed (if it grew large) only at the end,
+// instead of both after each change. Output goes to a buffered stream that is
+// never flushed per command; a command that fails prints one line naming it,
+// and the script goes on.
+class BatchRunner
 {
-    shared_ptr<IExporter> exporter;
-    shared_ptr<IReportGenerator> reportGenerator;
+    static constexpr size_t COMMIT_CHANGES = 1 << 16;
+    static constexpr size_t MAX_FIELDS = 12;
 
-public:
-    ExtendedStudentOperations(shared_ptr<IGradeCalculator> gradeStrategy, // Use IGradeCalculator
-                              shared_ptr<IExporter> exp,
-                              shared_ptr<IReportGenerator> repGen)
-        : StudentOperations(move(gradeStrategy)),
-          exporter(move(exp)),
-          reportGenerator(move(repGen))
+    ExtendedStudentOperations &ops;
+    ostream &out;
+    Student s; // reused, so its strings keep their capacity
+    int32_t today = AttendanceLog::today();
+
+    string_view fields[MAX_FIELDS];
+    size_t count = 0;
+
+    static string_view nextLine(string_view &script)
     {
+        size_t end = min(script.find('\n'), script.size());
+        string_view line = script.substr(0, end);
+        script.remove_prefix(min(end + 1, script.size()));
+        return line;
     }
 
-    void markAttendance()
+    // Splits a line into fields; false if it has too many or a quote is not closed
+    static bool split(string_view line, string_view *fields, size_t &count)
     {
-        for (auto &s : students)
+        count = 0;
+        size_t i = 0;
+        while (true)
         {
-            cout << "Mark attendance for " << s.name << " (P/A): ";
-            char a;
-            cin >> a;
-            s.attendance = (toupper(a) == 'P') ? "Present" : "Absent";
+            while (i < line.size() && (line[i] == ' ' || line[i] == '\t' || line[i] == '\r'))
+                ++i;
+            if (i == line.size())
+                return true;
+            if (count == MAX_FIELDS)
+                return false;
+            if (line[i] == '"')
+            {
+                size_t end = line.find('"', i + 1);
+                if (end == string_view::npos)
+                    return false;
+                fields[count++] = line.substr(i + 1, end - i - 1);
+                i = end + 1;
+                continue;
+            }
+            size_t start = i;
+            while (i < line.size() && line[i] != ' ' && line[i] != '\t' && line[i] != '\r')
+                ++i;
+            fields[count++] = line.substr(start, i - start);
         }
     }
 
-    void enterMarks()
+    template <typename T>
+    static bool number(string_view field, T &value)
     {
-        int roll;
-        cout << "Enter roll number: ";
-        cin >> roll;
+        auto result = from_chars(field.data(), field.data() + field.size(), value);
+        return result.ec == errc() && result.ptr == field.data() + field.size();
+    }
+
+    // fields[first..first + 5) as marks
+    bool marks(size_t first, float *m) const
+    {
+        for (int i = 0; i < 5; ++i)
+        {
+            if (!number(fields[first + i], m[i]))
+                return false;
+        }
+        return true;
+    }
 
-        auto it = find_if(students.begin(), students.end(),
-                          [roll](const Student &s)
-                          { return s.rollNo == roll; });
+    enum class Outcome
+    {
+        CHANGED,
+        DONE,      // ran and changed nothing
+        FAILED,    // message already printed
+        MALFORMED, // wrong fields for the command
+    };
 
-        if (it != students.end())
+    Outcome execute(size_t line)
+    {
+        string_view command = fields[0];
+        int roll = 0;
+        if (command == "add" && (count == 6 || count == 11))
         {
-            Student &s = *it;
-            cout << "Enter marks for 5 subjects (space separated): ";
-            for (int i = 0; i < 5; ++i)
+            s = Student();
+            s.name = fields[1];
+            s.studentClass = fields[3];
+            s.gender = fields[5];
+            if (!number(fields[2], s.rollNo) || !number(fields[4], s.age) || (count == 11 && !marks(6, s.marks)))
+                return Outcome::MALFORMED;
+            if (ops.applyAdd(s))
+                return Outcome::CHANGED;
+            out << "line " << line << ": roll number " << s.rollNo << " already exists\n";
+            return Outcome::FAILED;
+        }
+        if (command == "update" && count == 6)
+        {
+            if (!number(fields[1], roll))
+                return Outcome::MALFORMED;
+            if (ops.find(roll, s))
             {
-                cin >> s.marks[i];
+                s.name = fields[2];
+                s.studentClass = fields[3];
+                s.gender = fields[5];
+                if (!number(fields[4], s.age))
+                    return Outcome::MALFORMED;
+                ops.applyUpdate(s);
+                return Outcome::CHANGED;
             }
-            gradeCalc->calculateGrade(s); // Use interface
-            cout << "Marks updated. New grade: " << s.grade << "\n";
+        }
+        else if (command == "delete" && count == 2)
+        {
+            if (!number(fields[1], roll))
+                return Outcome::MALFORMED;
+            if (ops.applyDelete(roll))
+                return Outcome::CHANGED;
+        }
+        else if (command == "marks" && count == 7)
+        {
+            float m[5];
+            if (!number(fields[1], roll) || !marks(2, m))
+                return Outcome::MALFORMED;
+            if (ops.applyMarks(roll, m))
+                return Outcome::CHANGED;
+        }
+        else if (command == "attendance" && (count == 3 || count == 4))
+        {
+            char mark = fields[2].size() == 1 ? toupper(fields[2][0]) : 0;
+            int32_t day = today;
+            if (!number(fields[1], roll) || (mark != 'P' && mark != 'A') ||
+                (count == 4 && !AttendanceLog::parseDate(fields[3], day)))
+                return Outcome::MALFORMED;
+            if (ops.applyAttendance(roll, mark == 'P', day))
+                return Outcome::CHANGED;
+        }
+        else if (command == "report" && count == 2)
+        {
+            ops.writeClassReport(fields[1], out);
+            return Outcome::DONE;
+        }
+        else if (command == "export" && count <= 2)
+        {
+            ops.exportTo(count == 2 ? string(fields[1]) : "students.csv");
+            return Outcome::DONE;
+        }
+        else if (command == "save" && count == 1)
+        {
+            ops.saveData();
+            return Outcome::DONE;
         }
         else
         {
-            cout << "Student not found.\n";
+            return Outcome::MALFORMED;
         }
+        out << "line " << line << ": no student with roll number " << roll << "\n";
+        return Outcome::FAILED;
     }
 
-    void calculateGPA() const
+public:
+    struct Result
     {
-        for (const auto &s : students)
+        size_t commands = 0;
+        size_t changes = 0;
+        size_t failed = 0;
+        double seconds = 0;
+    };
+
+    BatchRunner(ExtendedStudentOperations &operations, ostream &output) : ops(operations), out(output) {}
+
+    Result run(string_view script)
+    {
+        Result result;
+        auto start = chrono::steady_clock::now();
+        size_t uncommitted = 0;
+        for (size_t line = 1; !script.empty(); ++line)
         {
-            cout << s.name << ": GPA = " << fixed << setprecision(2)
-                 << (s.percentage / 20.0) << "\n";
+            string_view text = nextLine(script);
+            if (!split(text, fields, count))
+            {
+                out << "line " << line << ": unreadable command\n";
+                ++result.failed;
+                continue;
+            }
+            if (count == 0 || fields[0][0] == '#')
+                continue;
+
+            ++result.commands;
+            switch (execute(line))
+            {
+            case Outcome::CHANGED:
+                ++result.changes;
+                if (++uncommitted == COMMIT_CHANGES)
+                {
+                    ops.syncJournal();
+                    uncommitted = 0;
+                }
+                break;
+            case Outcome::DONE:
+                break;
+            case Outcome::MALFORMED:
+                out << "line " << line << ": bad command: " << text << "\n";
+                [[fallthrough]];
+            case Outcome::FAILED:
+                ++result.failed;
+                break;
+            }
         }
+        ops.commitChanges();
+        result.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        return result;
     }
+};
 
-    void generateClassReport() const
+// ==================== Server Mode ====================
+
+// Frames of the --serve protocol. A request is uint32 payload length, uint8 op,
+// payload; the response to it is uint32 payload length, uint8 status, payload.
+// Numbers are in the byte order of the machine and strings are a uint32
+// length followed by the bytes, as in the journal. Payloads:
+//   INFO       -                    -> uint64 students, int32 lowest roll,
+//                                      int32 highest roll, uint32 n, n class names
+//   FIND       int32 roll           -> student (Journal::encodeStudent)
+//   ADD        student              -> -            (EXISTS if the roll is taken)
+//   UPDATE     student              -> -            (replaces the whole record)
+//   DELETE     int32 roll           -> -
+//   MARKS      int32 roll, 5 floats -> uint8 grade
+//   ATTENDANCE int32 roll, string   -> -            ("Present" or "Absent"; an
+//              [, int32 day]                          optional day number, else today)
+//   REPORT     string class         -> uint64 students, float64 average,
+//                                      float64 deviation, 5 float64 subject
+//                                      averages, uint8 n, n (char grade, uint32 students)
+//   EXPORT     string file          -> -            (CSV in the current list order)
+//   BACKUP     string file          -> -            (a complete snapshot file)
+// A change is answered only once its journal record is on disk.
+struct Wire
+{
+    enum Op : uint8_t
+    {
+        INFO = 1,
+        FIND,
+        ADD,
+        UPDATE,
+        DELETE,
+        MARKS,
+        ATTENDANCE,
+        REPORT,
+        EXPORT,
+        BACKUP
+    };
+
+    enum Status : uint8_t
+    {
+        OK = 0,
+        NOT_FOUND,
+        EXISTS,
+        BAD_REQUEST,
+        FAILED // the server could not carry it out
+    };
+
+    static constexpr size_t HEADER = 5;
+    static constexpr uint32_t MAX_PAYLOAD = 1 << 20;
+
+    // Starts a frame at the end of out; append the payload, then call end()
+    static size_t begin(string &out, uint8_t code)
     {
-        reportGenerator->generateReport(students);
+        size_t at = out.size();
+        out.append(4, '\0');
+        out.push_back(static_cast<char>(code));
+        return at;
     }
 
-    void exportData() const
+    static void end(string &out, size_t at)
     {
-        exporter->exportData(students);
+        uint32_t length = static_cast<uint32_t>(out.size() - at - HEADER);
+        memcpy(&out[at], &length, 4);
     }
 
-    void backupData() const
+    // Payload length of the frame at the start of data; false until its header is complete
+    static bool payloadLength(string_view data, uint32_t &length)
     {
-        time_t now = time(nullptr);
-        char buffer[80];
-        strftime(buffer, sizeof(buffer), "backup_%Y%m%d_%H%M%S.txt", localtime(&now));
-        string filename = buffer;
-        FileHandler::saveToFile(students, filename);
-        cout << "Backup created successfully: " << filename << "\n";
+        if (data.size() < HEADER)
+            return false;
+        memcpy(&length, data.data(), 4);
+        return true;
     }
+};
 
-    // Feature 2: Student Statistics
-    void showStatistics() const
+// Keeps the roster in memory and serves it over a Unix domain socket. One
+// thread runs an epoll loop that does all the socket I/O; complete requests go
+// to a worker pool. Lookups by roll number read the published copies of the
+// records and take no lock at all; reports share the roster lock, so they run
+// in parallel, and changes take it alone. Exports and backups hold the lock only to
+// pin a snapshot of the roster and write it out after letting go, so changes
+// go on while the file is written. A change is logged while the lock is held,
+// then handed to a sync thread that waits for the journal once for everything
+// that arrived meanwhile, so workers never wait on the disk. Each connection
+// has at most one request in progress, which keeps its responses in order;
+// any number of connections are served at once.
+class RosterServer
+{
+    struct Connection
     {
-        string cls;
-        cout << "Enter class for statistics: ";
-        cin >> cls;
+        int fd;
+        string in;  // received bytes not yet handled
+        string out; // response bytes not yet sent
+        bool busy = false;   // a request is with the workers
+        bool closed = false; // the peer went away while busy
+        bool writing = false; // waiting for the socket to take more
+    };
+
+    struct Reply
+    {
+        Connection *connection;
+        string bytes;
+    };
+
+    ExtendedStudentOperations &ops;
+    shared_mutex roster;
+    unique_ptr<ThreadPool> pool;
+    unordered_map<int, unique_ptr<Connection>> connections; // by fd; loop thread only
+    int epollFd = -1, listenFd = -1, wakeFd = -1, signalFd = -1;
+    atomic<size_t> served{0};
+
+    mutex replyLock;
+    vector<Reply> replies; // finished, for the loop to send
+
+    mutex syncLock;
+    condition_variable syncWake;
+    vector<Reply> unsynced; // answers to changes whose records are not on disk yet
+    bool stopping = false;
+    thread syncer;
+
+    void watch(int fd, uint32_t events, int op = EPOLL_CTL_ADD)
+    {
+        epoll_event event{};
+        event.events = events;
+        event.data.fd = fd;
+        epoll_ctl(epollFd, op, fd, &event);
+    }
+
+    // Passes finished responses to the loop thread
+    void deliver(vector<Reply> &finished)
+    {
+        {
+            lock_guard<mutex> guard(replyLock);
+            for (Reply &reply : finished)
+                replies.push_back(move(reply));
+        }
+        finished.clear();
+        uint64_t one = 1;
+        if (::write(wakeFd, &one, sizeof(one)) < 0)
+            cout << "Warning: could not wake the server loop.\n";
+    }
+
+    void syncLoop()
+    {
+        vector<Reply> batch;
+        unique_lock<mutex> guard(syncLock);
+        while (true)
+        {
+            syncWake.wait(guard, [this]
+                          { return stopping || !unsynced.empty(); });
+            if (unsynced.empty())
+                return;
+            batch.swap(unsynced);
+            guard.unlock();
+            ops.syncJournal();
+            if (ops.journalFull())
+            {
+                unique_lock<shared_mutex> exclusive(roster);
+                ops.commitChanges();
+            }
+            deliver(batch);
+            guard.lock();
+        }
+    }
+
+    // Runs one request on a worker. request is the op byte and the payload.
+    void handle(Connection *connection, const string &request)
+    {
+        ByteReader in(string_view(request).substr(1));
+        string response;
+        size_t at = Wire::begin(response, Wire::OK);
+        ByteWriter out(response);
+        Wire::Status status = Wire::OK;
+        bool changed = false;
+        Student s;
+        int32_t roll = 0;
+
+        switch (request[0])
+        {
+        case Wire::INFO:
+        {
+            shared_lock<shared_mutex> reading(roster);
+            pair<int, int> range = ops.rollRange();
+            vector<string> classes = ops.classNames();
+            out.put<uint64_t>(ops.count());
+            out.put<int32_t>(range.first);
+            out.put<int32_t>(range.second);
+            out.put<uint32_t>(classes.size());
+            for (const string &cls : classes)
+                out.putString(cls);
+            break;
+        }
+        case Wire::FIND:
+        {
+            if (!in.get(roll))
+            {
+                status = Wire::BAD_REQUEST;
+                break;
+            }
+            if (ops.findPublished(roll, s)) // lock-free, even while a change runs
+                Journal::encodeStudent(out, s);
+            else
+                status = Wire::NOT_FOUND;
+            break;
+        }
+        case Wire::ADD:
+        case Wire::UPDATE:
+        {
+            if (!Journal::decodeStudent(string_view(request).substr(1), s))
+            {
+                status = Wire::BAD_REQUEST;
+                break;
+            }
+            unique_lock<shared_mutex> writing(roster);
+            if (request[0] == Wire::ADD)
+                changed = ops.applyAdd(s);
+            else
+                changed = ops.applyUpdate(s);
+            if (!changed)
+                status = request[0] == Wire::ADD ? Wire::EXISTS : Wire::NOT_FOUND;
+            break;
+        }
+        case Wire::DELETE:
+        {
+            if (!in.get(roll))
+            {
+                status = Wire::BAD_REQUEST;
+                break;
+            }
+            unique_lock<shared_mutex> writing(roster);
+            changed = ops.applyDelete(roll);
+            if (!changed)
+                status = Wire::NOT_FOUND;
+            break;
+        }
+        case Wire::MARKS:
+        {
+            if (!in.get(roll) || !in.get(s.marks[0]) || !in.get(s.marks[1]) || !in.get(s.marks[2]) ||
+                !in.get(s.marks[3]) || !in.get(s.marks[4]))
+            {
+                status = Wire::BAD_REQUEST;
+                break;
+            }
+            unique_lock<shared_mutex> writing(roster);
+            char grade = ops.applyMarks(roll, s.marks);
+            changed = grade != 0;
+            if (changed)
+                out.put(grade);
+            else
+                status = Wire::NOT_FOUND;
+            break;
+        }
+        case Wire::ATTENDANCE:
+        {
+            if (!in.get(roll) || !in.getString(s.attendance) ||
+                (s.attendance != "Present" && s.attendance != "Absent"))
+            {
+                status = Wire::BAD_REQUEST;
+                break;
+            }
+            int32_t day;
+            if (!in.get(day))
+                day = AttendanceLog::today();
+            unique_lock<shared_mutex> writing(roster);
+            changed = ops.applyAttendance(roll, s.attendance == "Present", day);
+            if (!changed)
+                status = Wire::NOT_FOUND;
+            break;
+        }
+        case Wire::REPORT:
+        {
+            string cls;
+            if (!in.getString(cls))
+            {
+                status = Wire::BAD_REQUEST;
+                break;
+            }
+            ClassIndex::Stats stats;
+            {
+                shared_lock<shared_mutex> reading(roster);
+                stats = ops.classStats(cls);
+            }
+            out.put<uint64_t>(stats.count);
+            out.put(stats.average());
+            out.put(stats.deviation());
+            for (double sum : stats.subjectSums)
+                out.put(stats.marked ? sum / stats.marked : 0.0);
+            uint8_t letters = count_if(begin(stats.grades), end(stats.grades), [](uint32_t n)
+                                       { return n != 0; });
+            out.put(letters);
+            for (int grade = 0; grade < 128; ++grade)
+            {
+                if (stats.grades[grade])
+                {
+                    out.put(char(grade));
+                    out.put<uint32_t>(stats.grades[grade]);
+                }
+            }
+            break;
+        }
+        case Wire::EXPORT:
+        case Wire::BACKUP:
+        {
+            string filename;
+            if (!in.getString(filename) || filename.empty())
+            {
+                status = Wire::BAD_REQUEST;
+                break;
+            }
+            function<bool()> job;
+            {
+                shared_lock<shared_mutex> reading(roster);
+                if (request[0] == Wire::BACKUP)
+                {
+                    job = ops.backupJob(filename);
+                }
+                else
+                {
+                    job = [write = ops.exportJob(filename)]
+                    {
+                        write();
+                        return true;
+                    };
+                }
+            }
+            if (!job())
+                status = Wire::FAILED;
+            break;
+        }
+        default:
+            status = Wire::BAD_REQUEST;
+        }
+
+        if (status != Wire::OK)
+            response.resize(at + Wire::HEADER);
+        response[at + 4] = static_cast<char>(status);
+        Wire::end(response, at);
+
+        vector<Reply> reply;
+        reply.push_back({connection, move(response)});
+        if (!changed)
+        {
+            deliver(reply);
+            return;
+        }
+        {
+            lock_guard<mutex> guard(syncLock);
+            unsynced.push_back(move(reply.front()));
+        }
+        syncWake.notify_one();
+    }
+
+    // Hands the next complete request of an idle connection to the workers
+    void dispatch(Connection &c)
+    {
+        uint32_t length;
+        if (c.busy || c.closed || !Wire::payloadLength(c.in, length))
+            return;
+        if (length > Wire::MAX_PAYLOAD)
+        {
+            drop(c);
+            return;
+        }
+        if (c.in.size() < Wire::HEADER + length)
+            return;
+        string request = c.in.substr(4, 1 + length);
+        c.in.erase(0, Wire::HEADER + length);
+        c.busy = true;
+        Connection *connection = &c;
+        pool->submit([this, connection, request = move(request)]
+                     { handle(connection, request); });
+    }
+
+    // Sends what the socket takes now and waits for it to take the rest
+    void flush(Connection &c)
+    {
+        size_t sent = 0;
+        while (sent < c.out.size())
+        {
+            ssize_t n = send(c.fd, c.out.data() + sent, c.out.size() - sent, MSG_NOSIGNAL);
+            if (n < 0)
+            {
+                if (errno == EAGAIN || errno == EWOULDBLOCK)
+                    break;
+                drop(c);
+                return;
+            }
+            sent += n;
+        }
+        c.out.erase(0, sent);
+        bool pending = !c.out.empty();
+        if (pending != c.writing)
+        {
+            c.writing = pending;
+            watch(c.fd, pending ? EPOLLIN | EPOLLOUT : EPOLLIN, EPOLL_CTL_MOD);
+        }
+    }
+
+    // Closes a connection, or only stops watching it while a worker still has its request
+    void drop(Connection &c)
+    {
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, c.fd, nullptr);
+        if (c.busy)
+        {
+            c.closed = true;
+            return;
+        }
+        ::close(c.fd);
+        connections.erase(c.fd);
+    }
+
+    void receive(Connection &c)
+    {
+        char buffer[1 << 16];
+        while (true)
+        {
+            ssize_t n = recv(c.fd, buffer, sizeof(buffer), 0);
+            if (n > 0)
+            {
+                c.in.append(buffer, n);
+                continue;
+            }
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                break;
+            drop(c); // closed by the peer, or failed
+            return;
+        }
+        dispatch(c);
+    }
+
+    void accept()
+    {
+        while (true)
+        {
+            int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0)
+                return;
+            auto c = make_unique<Connection>();
+            c->fd = fd;
+            connections[fd] = move(c);
+            watch(fd, EPOLLIN);
+        }
+    }
+
+    // Sends the responses the workers and the sync thread finished
+    void sendReplies()
+    {
+        uint64_t count;
+        if (::read(wakeFd, &count, sizeof(count)) < 0)
+            return;
+        vector<Reply> finished;
+        {
+            lock_guard<mutex> guard(replyLock);
+            finished.swap(replies);
+        }
+        for (Reply &reply : finished)
+        {
+            Connection &c = *reply.connection;
+            c.busy = false;
+            served.fetch_add(1, memory_order_relaxed);
+            if (c.closed)
+            {
+                ::close(c.fd);
+                connections.erase(c.fd);
+                continue;
+            }
+            c.out += reply.bytes;
+            int fd = c.fd;
+            flush(c);
+            if (connections.count(fd))
+                dispatch(c);
+        }
+    }
+
+    bool listen(const string &path)
+    {
+        sockaddr_un address{};
+        if (path.size() >= sizeof(address.sun_path))
+        {
+            cout << "Socket path is too long: " << path << "\n";
+            return false;
+        }
+        address.sun_family = AF_UNIX;
+        memcpy(address.sun_path, path.c_str(), path.size() + 1);
+        listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        unlink(path.c_str()); // left behind by a server that did not stop cleanly
+        // Requests skip the login, so only this user may connect: the socket
+        // is created 0600 rather than changed to it after bind
+        mode_t mask = umask(077);
+        bool bound = listenFd >= 0 && bind(listenFd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) == 0;
+        umask(mask);
+        if (!bound || chmod(path.c_str(), 0600) != 0 || ::listen(listenFd, SOMAXCONN) != 0)
+        {
+            cout << "Failed to listen on " << path << ": " << strerror(errno) << "\n";
+            return false;
+        }
+        return true;
+    }
+
+public:
+    explicit RosterServer(ExtendedStudentOperations &operations) : ops(operations) {}
+
+    RosterServer(const RosterServer &) = delete;
+    RosterServer &operator=(const RosterServer &) = delete;
+
+    static sigset_t stopSignals()
+    {
+        sigset_t signals;
+        sigemptyset(&signals);
+        sigaddset(&signals, SIGINT);
+        sigaddset(&signals, SIGTERM);
+        return signals;
+    }
+
+    // The loop reads SIGINT and SIGTERM from a descriptor, so no thread may
+    // take them; call this before the first thread starts
+    static void blockStopSignals()
+    {
+        sigset_t signals = stopSignals();
+        pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+    }
+
+    // Serves until SIGINT or SIGTERM, then saves; nonzero if it could not start
+    int run(const string &path, size_t threads)
+    {
+        if (!listen(path))
+            return 1;
+        epollFd = epoll_create1(EPOLL_CLOEXEC);
+        wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        sigset_t signals = stopSignals();
+        signalFd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+        watch(listenFd, EPOLLIN);
+        watch(wakeFd, EPOLLIN);
+        watch(signalFd, EPOLLIN);
 
-        vector<Student> classStudents;
-        for (const auto &s : students)
-        {
-            if (s.studentClass == cls)
-                classStudents.push_back(s);
-        }
+        ops.warmIndexes();
+        ops.publishRecords();
+        pool = make_unique<ThreadPool>(threads);
+        syncer = thread(&RosterServer::syncLoop, this);
+        cout << "Serving " << ops.count() << " students on " << path << " with " << pool->size()
+             << " workers; Ctrl+C stops the server." << endl;
 
-        if (classStudents.empty())
+        auto start = chrono::steady_clock::now();
+        epoll_event events[64];
+        bool running = true;
+        while (running)
         {
-            cout << "No students found in class " << cls << "\n";
-            return;
+            int n = epoll_wait(epollFd, events, 64, -1);
+            for (int i = 0; i < n; ++i)
+            {
+                int fd = events[i].data.fd;
+                if (fd == listenFd)
+                {
+                    accept();
+                }
+                else if (fd == wakeFd)
+                {
+                    sendReplies();
+                }
+                else if (fd == signalFd)
+                {
+                    running = false;
+                }
+                else
+                {
+                    auto it = connections.find(fd);
+                    if (it == connections.end())
+                        continue;
+                    Connection &c = *it->second;
+                    if (events[i].events & EPOLLOUT)
+                        flush(c);
+                    if (connections.count(fd) && (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)))
+                        receive(c);
+                }
+            }
         }
 
-        float totalPercentage = 0;
-        map<char, int> gradeCount;
-        for (const auto &s : classStudents)
+        // Requests already taken finish, and their changes are synced; their
+        // responses are not sent
+        ::close(listenFd);
+        unlink(path.c_str());
+        pool.reset();
         {
-            totalPercentage += s.percentage;
-            gradeCount[s.grade]++;
+            lock_guard<mutex> guard(syncLock);
+            stopping = true;
         }
+        syncWake.notify_one();
+        syncer.join();
+        for (auto &entry : connections)
+            ::close(entry.first);
+        connections.clear();
+        ::close(epollFd);
+        ::close(wakeFd);
+        ::close(signalFd);
 
-        cout << "\nClass " << cls << " Statistics:\n";
-        cout << "Total Students: " << classStudents.size() << "\n";
-        cout << "Average Percentage: " << fixed << setprecision(2)
-             << (totalPercentage / classStudents.size()) << "%\n";
-        cout << "Grade Distribution:\n";
-        for (const auto &pair : gradeCount)
-        {
-            cout << "Grade " << pair.first << ": " << pair.second << " students\n";
-        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        cout << "Server stopped: " << served.load() << " requests in " << fixed << setprecision(1) << seconds
+             << " s.\n";
+        ops.saveData();
+        return 0;
     }
+};
 
-    void importFromCSV()
-    {
-        string filename;
-        cout << "Enter CSV filename to import: ";
-        cin.ignore();
-        getline(cin, filename);
+// Blocking client of RosterServer, one request at a time
+class RosterClient
+{
+    int fd = -1;
+    string frame;
 
-        ifstream file(filename);
-        if (!file.is_open())
+    bool readAll(char *data, size_t length)
+    {
+        while (length > 0)
         {
-            cout << "Failed to open file: " << filename << "\n";
-            return;
+            ssize_t n = recv(fd, data, length, 0);
+            if (n <= 0)
+                return false;
+            data += n;
+            length -= n;
         }
+        return true;
+    }
 
-        string line;
-        getline(file, line); // Skip header
-        while (getline(file, line))
-        {
-            stringstream ss(line);
-            Student s;
-            string temp;
-
-            getline(ss, temp, ','); // Roll
-            s.rollNo = stoi(temp);
-            getline(ss, s.name, ',');
-            getline(ss, s.studentClass, ',');
-            getline(ss, temp, ','); // Age
-            s.age = stoi(temp);
-            getline(ss, s.gender, ',');
-            getline(ss, temp, ','); // Percentage
-            s.percentage = stof(temp);
-            getline(ss, temp, ','); // Grade
-            s.grade = temp[0];
-            getline(ss, s.attendance, ',');
+public:
+    RosterClient() = default;
+    RosterClient(const RosterClient &) = delete;
+    RosterClient &operator=(const RosterClient &) = delete;
 
-            students.push_back(s);
-            gradeCalc->calculateGrade(s); // Recalculate to ensure consistency
-        }
-        cout << "Data imported successfully from " << filename << "\n";
+    ~RosterClient()
+    {
+        if (fd >= 0)
+            ::close(fd);
     }
 
-    // Feature 3: Find Topper
-    void findTopper() const
+    bool connect(const string &path)
     {
-        string cls;
-        cout << "Enter class to find topper: ";
-        cin >> cls;
-
-        float maxPercentage = -1;
-        const Student *topper = nullptr;
+        sockaddr_un address{};
+        if (path.size() >= sizeof(address.sun_path))
+            return false;
+        address.sun_family = AF_UNIX;
+        memcpy(address.sun_path, path.c_str(), path.size() + 1);
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        return fd >= 0 && ::connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) == 0;
+    }
 
-        for (const auto &s : students)
+    // Sends one request and waits for the response; false if the connection failed
+    bool call(Wire::Op op, string_view payload, Wire::Status &status, string &response)
+    {
+        frame.clear();
+        size_t at = Wire::begin(frame, op);
+        frame.append(payload);
+        Wire::end(frame, at);
+        for (size_t sent = 0; sent < frame.size();)
         {
-            if (s.studentClass == cls && s.percentage > maxPercentage)
-            {
-                maxPercentage = s.percentage;
-                topper = &s;
-            }
+            ssize_t n = send(fd, frame.data() + sent, frame.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0)
+                return false;
+            sent += n;
         }
 
-        if (topper)
-        {
-            cout << "Topper of class " << cls << ":\n";
-            cout << "Name: " << topper->name << "\n";
-            cout << "Roll No: " << topper->rollNo << "\n";
-            cout << "Percentage: " << fixed << setprecision(2) << topper->percentage << "%\n";
-            cout << "Grade: " << topper->grade << "\n";
-        }
-        else
-        {
-            cout << "No students found in class " << cls << "\n";
-        }
+        char header[Wire::HEADER];
+        uint32_t length;
+        if (!readAll(header, Wire::HEADER) || !Wire::payloadLength(string_view(header, Wire::HEADER), length) ||
+            length > Wire::MAX_PAYLOAD)
+            return false;
+        status = static_cast<Wire::Status>(header[4]);
+        response.resize(length);
+        return readAll(&response[0], length);
     }
 };
 
 // ==================== Menu System ====================
 
+// Command-line settings
+struct Options
+{
+    size_t threads = max(thread::hardware_concurrency(), 1u); // workers for bulk work
+    bool verifyStats = false;                                 // --verify-stats
+    string batch;                                             // --batch FILE, or - for stdin
+    string serve;                                             // --serve SOCKET
+};
+
 class MenuSystem
 {
     unique_ptr<ExtendedStudentOperations> ops;
     map<int, function<void()>> menuActions;
+    // Menu entries that modify the roster (everything else only reads it)
+    const set<int> changesRoster{1, 4, 5, 6, 8, 11, 14, 17, 19, 23};
 
     void initializeMenu()
     {
@@ -625,18 +7777,36 @@ class MenuSystem
         { ops->findTopper(); };
         menuActions[16] = [this]()
         { AuthManager::updatePassword(); };
+        menuActions[18] = [this]()
+        { ops->exportTextFile(); };
+        menuActions[19] = [this]()
+        { ops->importTextFile(); };
+        menuActions[20] = [this]()
+        { ops->showTopStudents(); };
+        menuActions[21] = [this]()
+        { ops->showStudentRank(); };
+        menuActions[22] = [this]()
+        { ops->showPercentageRange(); };
+        menuActions[23] = [this]()
+        { ops->changeGradingPolicy(); };
+        menuActions[24] = [this]()
+        { ops->compareGradingPolicies(); };
+        menuActions[25] = [this]()
+        { ops->showAttendanceHistory(); };
     }
 
 public:
-    MenuSystem()
+    explicit MenuSystem(const Options &options)
     {
-        auto gradeStrategy = make_shared<DefaultGradeStrategy>();
-        auto exporter = make_shared<CSVExporter>();
+        auto pool = make_shared<ThreadPool>(options.threads);
+        auto exporter = make_shared<CSVExporter>(pool);
         auto reportGen = make_shared<TextReportGenerator>();
-        auto gradeCalc = make_shared<GradeCalculator>(gradeStrategy); // Create GradeCalculator
+        // The built-in policy is fixed, so its calculator is resolved at compile time
+        auto gradeCalc = make_shared<StaticGradeCalculator<DefaultGradeStrategy>>();
 
         ops = make_unique<ExtendedStudentOperations>(
-            gradeCalc, exporter, reportGen); // Pass IGradeCalculator
+            gradeCalc, exporter, reportGen, pool); // Pass IGradeCalculator
+        ops->setVerifyStats(options.verifyStats);
 
         ops->loadData();
         initializeMenu();
@@ -659,11 +7829,18 @@ public:
                  << "7. Calculate GPA\n8. Mark Attendance\n9. Class Report\n"
                  << "10. Export Data\n11. Sort Students\n12. Backup Data\n"
                  << "13. Show Statistics\n14. Import from CSV\n15. Find Topper\n"
-                 << "16. Update Password\n17. Save & Exit\n"
+                 << "16. Update Password\n17. Save & Exit\n18. Export Text File\n"
+                 << "19. Import Text File\n20. Top Students\n21. Student Rank\n"
+                 << "22. Students by Percentage\n23. Change Grading Policy\n"
+                 << "24. Compare Grading Policies\n25. Attendance History\n"
                  << "Enter choice: ";
 
             cin >> choice;
 
+            // A background regrade is published once it is done; anything that
+            // changes the roster waits for it first
+            ops->publishRegrade(changesRoster.count(choice) > 0);
+
             if (choice == 17)
             {
                 ops->saveData();
@@ -682,13 +7859,985 @@ public:
 
         } while (true);
     }
+
+    // Runs a BatchRunner script from a file (or stdin for "-") in place of the
+    // menus; nonzero if any command failed
+    int runBatch(const string &filename)
+    {
+        string input;
+        MappedFile file;
+        string_view script;
+        if (filename == "-")
+        {
+            char buffer[1 << 16];
+            ssize_t n;
+            while ((n = ::read(STDIN_FILENO, buffer, sizeof(buffer))) > 0)
+                input.append(buffer, n);
+            script = input;
+        }
+        else if (file.open(filename))
+        {
+            script = string_view(file.data(), file.size());
+        }
+        else if (!ifstream(filename))
+        {
+            cout << "Failed to open file: " << filename << "\n";
+            return 1;
+        }
+
+        BatchRunner runner(*ops, cout);
+        BatchRunner::Result result = runner.run(script);
+        cout << "Batch: " << result.commands << " commands, " << result.changes << " changes, " << result.failed
+             << " failed in " << fixed << setprecision(3) << result.seconds << " s ("
+             << setprecision(0) << result.changes / max(result.seconds, 1e-9) << " changes/sec)\n";
+        return result.failed ? 1 : 0;
+    }
+
+    // Serves the roster over a Unix domain socket in place of the menus
+    int runServer(const string &path, size_t threads)
+    {
+        RosterServer server(*ops);
+        return server.run(path, threads);
+    }
 };
 
+// ==================== Benchmarks ====================
+
+// Counts every heap allocation the program makes (operator new is replaced
+// globally; new[] and the nothrow forms go through it), so a benchmark can
+// show what an operation costs in mallocs. Only in builds made with
+// -DSMS_COUNT_ALLOCATIONS: the shared counter would otherwise be one more
+// contended cache line for every allocating thread.
+#ifdef SMS_COUNT_ALLOCATIONS
+static atomic<size_t> heapAllocations{0};
+
+[[gnu::noinline]] void *operator new(size_t bytes)
+{
+    heapAllocations.fetch_add(1, memory_order_relaxed);
+    if (void *p = malloc(bytes ? bytes : 1))
+        return p;
+    throw bad_alloc();
+}
+
+[[gnu::noinline]] void operator delete(void *p) noexcept { free(p); }
+[[gnu::noinline]] void operator delete(void *p, size_t) noexcept { free(p); }
+#endif
+
+// --bench-grading N: regrades N synthetic students the old way (one virtual
+// calculateGrade per record, written back with setGrade) and with the batch
+// column kernels, and checks that both give the same percentages and grades
+int benchmarkGrading(size_t rows)
+{
+    StudentTable students;
+    students.reserve(rows);
+    Student s;
+    s.name = "Student";
+    s.studentClass = "10A";
+    s.gender = "M";
+    uint32_t seed = 12345;
+    for (size_t i = 0; i < rows; ++i)
+    {
+        s.rollNo = i + 1;
+        for (float &mark : s.marks)
+        {
+            seed = seed * 1664525 + 1013904223;
+            mark = (seed >> 8) % 10001 / 100.0f;
+        }
+        students.append(s);
+    }
+
+    auto strategy = make_shared<DefaultGradeStrategy>();
+    shared_ptr<IGradeCalculator> calc = make_shared<GradeCalculator>(strategy);
+    auto time = [](auto fn)
+    {
+        auto start = chrono::steady_clock::now();
+        fn();
+        return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    };
+
+    double perRecord = time([&]
+                            {
+                                Student r;
+                                for (size_t slot = 0; slot < students.size(); ++slot)
+                                {
+                                    for (int m = 0; m < 5; ++m)
+                                        r.marks[m] = students.mark(slot, m);
+                                    calc->calculateGrade(r);
+                                    students.setGrade(slot, r.percentage, r.grade);
+                                } });
+    vector<float> percentages(rows);
+    vector<char> grades(rows);
+    for (size_t slot = 0; slot < rows; ++slot)
+    {
+        percentages[slot] = students.percentage(slot);
+        grades[slot] = students.grade(slot);
+    }
+
+    double batch = time([&]
+                        { calc->gradeTable(students); });
+    size_t mismatches = 0;
+    for (size_t slot = 0; slot < rows; ++slot)
+    {
+        if (students.percentage(slot) != percentages[slot] || students.grade(slot) != grades[slot])
+            ++mismatches;
+    }
+
+#if defined(__AVX2__)
+    const char *kernel = "AVX2";
+#elif defined(__SSE2__)
+    const char *kernel = "SSE2";
+#else
+    const char *kernel = "scalar";
+#endif
+    cout << "Grading " << rows << " students:\n"
+         << fixed << setprecision(1)
+         << "  per record (virtual): " << perRecord * 1000 << " ms, " << setprecision(0)
+         << rows / max(perRecord, 1e-9) << " students/sec\n"
+         << setprecision(1)
+         << "  batch (" << kernel << "):        " << batch * 1000 << " ms, " << setprecision(0)
+         << rows / max(batch, 1e-9) << " students/sec\n"
+         << setprecision(1) << "  speedup: " << perRecord / max(batch, 1e-9) << "x, "
+         << mismatches << " mismatches\n";
+    return mismatches ? 1 : 0;
+}
+
+// --bench-strategies N: grades N percentages through each way of applying a
+// strategy - a virtual call into the old if-chain, a virtual call into the
+// table-driven strategy, the compile-time StaticGradeCalculator, and the
+// bucket table and cutoff count used directly
+int benchmarkStrategies(size_t count)
+{
+    // The branchy ladder DefaultGradeStrategy used to be, kept as the baseline
+    class IfChainStrategy : public IGradeStrategy
+    {
+    public:
+        char calculateGrade(float percentage) const override
+        {
+            if (percentage >= 90)
+                return 'A';
+            if (percentage >= 80)
+                return 'B';
+            if (percentage >= 70)
+                return 'C';
+            if (percentage >= 60)
+                return 'D';
+            return 'F';
+        }
+    };
+
+    vector<float> percentages(count);
+    uint32_t seed = 12345;
+    for (float &p : percentages)
+    {
+        seed = seed * 1664525 + 1013904223;
+        p = (seed >> 8) % 10001 / 100.0f;
+    }
+
+    // Picked at run time so the compiler cannot see through the virtual calls
+    vector<shared_ptr<IGradeStrategy>> strategies{make_shared<IfChainStrategy>(),
+                                                  make_shared<DefaultGradeStrategy>()};
+    volatile size_t pick = 0;
+    const IGradeStrategy &ifChain = *strategies[pick];
+    const IGradeStrategy &table = *strategies[pick + 1];
+    StaticGradeCalculator<DefaultGradeStrategy> inlined;
+
+    vector<char> expected(count), grades(count);
+    auto run = [&](const char *label, auto gradeOf)
+    {
+        auto start = chrono::steady_clock::now();
+        for (size_t i = 0; i < count; ++i)
+            grades[i] = gradeOf(percentages[i]);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        if (label == nullptr)
+        {
+            expected = grades;
+            return;
+        }
+        size_t mismatches = 0;
+        for (size_t i = 0; i < count; ++i)
+            mismatches += grades[i] != expected[i];
+        cout << "  " << left << setw(34) << label << right << fixed << setprecision(2) << setw(8)
+             << seconds * 1e9 / max<size_t>(count, 1) << " ns/grade" << (mismatches ? "  MISMATCH" : "") << "\n";
+    };
+
+    run(nullptr, [&](float p)
+        { return ifChain.calculateGrade(p); });
+    cout << "Grading " << count << " percentages:\n";
+    run("virtual, if-chain (old default)", [&](float p)
+        { return ifChain.calculateGrade(p); });
+    run("virtual, table-driven strategy", [&](float p)
+        { return table.calculateGrade(p); });
+    run("template StaticGradeCalculator", [&](float p)
+        { return inlined.gradeFor(p); });
+    run("bucket table lookup", [](float p)
+        { return DefaultGradeStrategy::buckets.lookup(p); });
+    run("constexpr cutoff count", [](float p)
+        { return DefaultGradeStrategy::ladder.gradeOf(p); });
+    return 0;
+}
+
+// --bench-sort N: sorts N synthetic students by every key, timing the radix
+// sort (with the pool) against a comparison sort of the slots, and checks that
+// both give the same order; then times applying the order to the table
+int benchmarkSort(size_t rows)
+{
+    StudentTable students;
+    students.reserve(rows, rows * 16);
+    vector<int> rolls(rows);
+    iota(rolls.begin(), rolls.end(), 1);
+    uint32_t seed = 12345;
+    auto random = [&seed]
+    {
+        seed = seed * 1664525 + 1013904223;
+        return seed >> 8;
+    };
+    for (size_t i = rows; i > 1; --i)
+        swap(rolls[i - 1], rolls[random() % i]);
+    const char *classes[] = {"10A", "10B", "10C", "9A", "9B", "9C", "8A", "8B"};
+    const char *names[] = {"Ali", "sara", "Bilal", "ayesha", "Hamza", "Zainab", "Usman", "fatima"};
+    Student s;
+    for (size_t i = 0; i < rows; ++i)
+    {
+        s.rollNo = rolls[i];
+        s.name = string(names[random() % 8]) + " " + to_string(random() % 100000);
+        s.studentClass = classes[random() % 8];
+        s.age = 10 + random() % 9;
+        for (float &mark : s.marks)
+            mark = random() % 10001 / 100.0f;
+        s.percentage = (s.marks[0] + s.marks[1] + s.marks[2] + s.marks[3] + s.marks[4]) / 5;
+        students.append(s);
+    }
+
+    ThreadPool pool(max(thread::hardware_concurrency(), 1u));
+    auto time = [](auto fn)
+    {
+        auto start = chrono::steady_clock::now();
+        fn();
+        return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    };
+    auto less = [&](SortKey key, size_t a, size_t b)
+    {
+        switch (key)
+        {
+        case SortKey::NAME:
+            return RosterSort::nameLess(students.name(a), students.name(b));
+        case SortKey::CLASS_PERCENTAGE:
+            if (students.studentClass(a) != students.studentClass(b))
+                return students.studentClass(a) < students.studentClass(b);
+            return students.percentage(a) > students.percentage(b);
+        case SortKey::AGE:
+            return students.age(a) < students.age(b);
+        default:
+            return students.rollNo(a) < students.rollNo(b);
+        }
+    };
+
+    // A change to the sort field of a student, as updateStudent or enterMarks
+    // would make it; roll numbers stay, so for them it is a delete and re-add
+    auto change = [&](SortKey key, size_t slot)
+    {
+        if (key == SortKey::ROLL)
+            return;
+        Student t = students.get(slot);
+        if (key == SortKey::NAME)
+            t.name = string(names[random() % 8]) + " " + to_string(random() % 100000);
+        else if (key == SortKey::CLASS_PERCENTAGE)
+            t.percentage = random() % 10001 / 100.0f;
+        else
+            t.age = 10 + random() % 9;
+        students.set(slot, t);
+    };
+    constexpr size_t CHANGES = 10000;
+
+    const char *labels[] = {"roll number", "name", "class, percentage", "age"};
+    cout << "Sorting " << rows << " students (" << pool.size() << " threads):\n";
+    size_t mismatches = 0;
+    for (int k = 0; k < int(SortKey::COUNT); ++k)
+    {
+        SortKey key = SortKey(k);
+        vector<size_t> expected(rows), order;
+        iota(expected.begin(), expected.end(), 0);
+        double compared = time([&]
+                               { stable_sort(expected.begin(), expected.end(), [&](size_t a, size_t b)
+                                             { return less(key, a, b); }); });
+        double radix = time([&]
+                            { order = RosterSort::order(students, key, &pool); });
+        bool same = order == expected;
+
+        // The maintained view, with slots as handles: built once, then every
+        // change moves one student
+        SortedView view;
+        auto before = [&](uint32_t a, uint32_t b)
+        { return RosterSort::before(students, key, a, b); };
+        double built = time([&]
+                            {
+                                vector<size_t> byRoll = RosterSort::order(students, SortKey::ROLL, &pool);
+                                if (key != SortKey::ROLL)
+                                    byRoll = RosterSort::order(students, key, &pool, &byRoll);
+                                view.assign(vector<uint32_t>(byRoll.begin(), byRoll.end())); });
+        double changed = time([&]
+                              {
+                                  for (size_t c = 0; c < CHANGES; ++c)
+                                  {
+                                      size_t slot = random() % rows;
+                                      view.erase(slot, before);
+                                      change(key, slot);
+                                      view.insert(slot, before);
+                                  } });
+        size_t position = 0, previous = 0;
+        view.forEach([&](uint32_t slot)
+                     {
+                         same = same && (position++ == 0 || before(previous, slot));
+                         previous = slot; });
+        same = same && position == rows;
+        mismatches += !same;
+        cout << "  " << left << setw(20) << labels[k] << right << fixed << setprecision(1)
+             << "radix " << setw(7) << radix * 1000 << " ms   comparison sort " << setw(7) << compared * 1000
+             << " ms   view built " << setw(7) << built * 1000 << " ms, " << setprecision(2) << setw(6)
+             << changed / CHANGES * 1e6 << " us per change" << (same ? "" : "  MISMATCH") << "\n";
+    }
+    return mismatches ? 1 : 0;
+}
+
+// --bench-load FILE: loads a roster the way the program does at start-up (a
+// snapshot is mapped, a text file is read into a table sized from the file)
+// and reports the time and (with SMS_COUNT_ALLOCATIONS) the heap allocations it took
+int benchmarkLoad(const string &filename)
+{
+    StudentTable students;
+    RollIndex index;
+    FileHandler::SnapshotMeta meta;
+    FileHandler::SnapshotLayout layout;
+    bool snapshot = FileHandler::isSnapshot(filename);
+    if (!snapshot && !ifstream(filename))
+    {
+        cout << "Failed to open file: " << filename << "\n";
+        return 1;
+    }
+    StaticGradeCalculator<DefaultGradeStrategy> calc;
+
+#ifdef SMS_COUNT_ALLOCATIONS
+    size_t allocations = heapAllocations.load();
+#endif
+    auto start = chrono::steady_clock::now();
+    if (snapshot)
+    {
+        if (!FileHandler::mapSnapshot(filename, students, index, meta, &layout))
+            return 1;
+    }
+    else
+    {
+        size_t expected = CsvReader::estimateRows(filename);
+        students.reserve(expected, FileHandler::textBytes(filename));
+        index.reserve(expected);
+        FileHandler::loadFromFile(filename, [&](Student &s)
+                                  {
+                                      calc.calculateGrade(s);
+                                      if (index.insert(s.rollNo, students.size()))
+                                          students.append(s); });
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    cout << "Loaded " << students.size() << " students from " << filename << (snapshot ? " (snapshot)" : " (text)")
+         << " in " << fixed << setprecision(1) << seconds * 1000 << " ms\n";
+#ifdef SMS_COUNT_ALLOCATIONS
+    allocations = heapAllocations.load() - allocations;
+    cout << "  heap allocations: " << allocations << " (" << setprecision(3)
+         << allocations * 1000.0 / max<size_t>(students.size(), 1) << " per 1000 students)\n";
+#else
+    cout << "  (build with -DSMS_COUNT_ALLOCATIONS to count heap allocations)\n";
+#endif
+    return 0;
+}
+
+// Drives a running --serve server from `clients` connections at once, each
+// sending its next request as soon as the last one is answered, and reports
+// throughput and latency percentiles. mix gives the percentage of lookups,
+// mark updates and class reports, e.g. "80/15/5".
+int benchmarkServer(const string &path, size_t clients, size_t requests, const string &mix)
+{
+    int share[3];
+    char extra;
+    if (sscanf(mix.c_str(), "%d/%d/%d%c", &share[0], &share[1], &share[2], &extra) != 3 || share[0] < 0 ||
+        share[1] < 0 || share[2] < 0 || share[0] + share[1] + share[2] != 100)
+    {
+        cout << "The mix must be three percentages that add up to 100, such as 80/15/5.\n";
+        return 1;
+    }
+
+    RosterClient probe;
+    Wire::Status status;
+    string response;
+    if (!probe.connect(path) || !probe.call(Wire::INFO, {}, status, response))
+    {
+        cout << "Failed to connect to " << path << "\n";
+        return 1;
+    }
+    ByteReader in(response);
+    uint64_t students = 0;
+    int32_t low = 0, high = 0;
+    uint32_t classCount = 0;
+    in.get(students);
+    in.get(low);
+    in.get(high);
+    in.get(classCount);
+    vector<string> classes(classCount);
+    for (string &cls : classes)
+        in.getString(cls);
+    if (classes.empty())
+        classes.emplace_back(); // an unknown class still makes a report request
+
+    // Per client: latencies in microseconds by kind of request
+    struct Tally
+    {
+        vector<double> latency[3];
+        size_t notFound = 0;
+        bool failed = false;
+    };
+    vector<Tally> tallies(max<size_t>(clients, 1));
+    size_t perClient = requests / tallies.size();
+
+    auto client = [&](size_t id)
+    {
+        Tally &tally = tallies[id];
+        RosterClient connection;
+        if (!connection.connect(path))
+        {
+            tally.failed = true;
+            return;
+        }
+        uint32_t seed = 12345 + 7919 * uint32_t(id);
+        auto random = [&seed]
+        {
+            seed = seed * 1664525 + 1013904223;
+            return seed >> 8;
+        };
+        uint64_t span = uint64_t(int64_t(high) - low) + 1;
+        string payload, reply;
+        Wire::Status result;
+        for (size_t r = 0; r < perClient; ++r)
+        {
+            int pick = random() % 100;
+            int kind = pick < share[0] ? 0 : pick < share[0] + share[1] ? 1 : 2;
+            int32_t roll = int32_t(low + int64_t(random() % span));
+            payload.clear();
+            ByteWriter out(payload);
+            Wire::Op op = Wire::FIND;
+            if (kind == 0)
+            {
+                out.put(roll);
+            }
+            else if (kind == 1)
+            {
+                op = Wire::MARKS;
+                out.put(roll);
+                for (int m = 0; m < 5; ++m)
+                    out.put(random() % 10001 / 100.0f);
+            }
+            else
+            {
+                op = Wire::REPORT;
+                out.putString(classes[random() % classes.size()]);
+            }
+
+            auto start = chrono::steady_clock::now();
+            if (!connection.call(op, payload, result, reply))
+            {
+                tally.failed = true;
+                return;
+            }
+            tally.latency[kind].push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - start).count());
+            tally.notFound += result == Wire::NOT_FOUND;
+        }
+    };
+
+    auto start = chrono::steady_clock::now();
+    vector<thread> threads;
+    for (size_t id = 0; id < tallies.size(); ++id)
+        threads.emplace_back(client, id);
+    for (thread &t : threads)
+        t.join();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    vector<double> latency[4]; // by kind, then all of them
+    size_t notFound = 0, failed = 0;
+    for (Tally &tally : tallies)
+    {
+        for (int kind = 0; kind < 3; ++kind)
+        {
+            latency[kind].insert(latency[kind].end(), tally.latency[kind].begin(), tally.latency[kind].end());
+            latency[3].insert(latency[3].end(), tally.latency[kind].begin(), tally.latency[kind].end());
+        }
+        notFound += tally.notFound;
+        failed += tally.failed;
+    }
+
+    size_t done = latency[3].size();
+    cout << "Load test on " << path << " (" << students << " students): " << tallies.size() << " clients, mix "
+         << mix << "\n"
+         << "  " << done << " requests in " << fixed << setprecision(2) << seconds << " s ("
+         << setprecision(0) << done / max(seconds, 1e-9) << " requests/sec), " << notFound
+         << " for unknown roll numbers\n";
+    const char *labels[] = {"search", "update", "report", "all"};
+    cout << "  " << left << setw(8) << "" << right << setw(10) << "requests" << setw(12) << "p50 us"
+         << setw(12) << "p99 us" << setw(12) << "p999 us" << "\n";
+    for (int kind = 0; kind < 4; ++kind)
+    {
+        vector<double> &v = latency[kind];
+        if (v.empty())
+            continue;
+        sort(v.begin(), v.end());
+        auto percentile = [&](double p)
+        { return v[min(v.size() - 1, size_t(p * v.size()))]; };
+        cout << "  " << left << setw(8) << labels[kind] << right << setw(10) << v.size() << setprecision(1)
+             << setw(12) << percentile(0.5) << setw(12) << percentile(0.99) << setw(12) << percentile(0.999)
+             << "\n";
+    }
+    if (failed)
+        cout << "Warning: " << failed << " clients lost their connection.\n";
+    return failed ? 1 : 0;
+}
+
+// Stress test of RecordDirectory: `writers` threads keep publishing new
+// versions of students while 1, 2, 4 ... 64 reader threads look them up, and
+// every read is checked. Each writer owns the roll numbers r with
+// (r - 1) % writers equal to its number; version n of a student has all five
+// marks and the percentage equal to n, and the writer counts n as issued
+// before publishing it and as committed after. A read is linearizable when
+// the record it returns is whole (six equal numbers) and its version lies
+// between what was committed before the read started and what was issued
+// after it ended. One more writer keeps putting and erasing roll numbers past
+// `rows`, so lookups also run while new entries are being filled in; any read
+// may only ever return the roll number it asked for.
+int benchmarkLookups(size_t rows, size_t writers)
+{
+    rows = max<size_t>(rows, 1);
+    writers = max<size_t>(min(writers, rows), 1);
+    RecordDirectory directory;
+    unique_ptr<atomic<uint32_t>[]> issued(new atomic<uint32_t>[rows]()), committed(new atomic<uint32_t>[rows]());
+    Student s;
+    s.name = "Student";
+    s.studentClass = "10A";
+    s.gender = "F";
+    for (size_t i = 0; i < rows; ++i)
+    {
+        s.rollNo = int(i + 1);
+        directory.put(s);
+    }
+
+    struct alignas(64) Count
+    {
+        size_t operations = 0;
+        size_t violations = 0;
+    };
+    atomic<bool> stop{false};
+
+    auto writer = [&](size_t id, Count &count)
+    {
+        Student t = s;
+        uint32_t seed = 777 + uint32_t(id);
+        size_t mine = (rows - id + writers - 1) / writers;
+        while (!stop.load(memory_order_relaxed))
+        {
+            seed = seed * 1664525 + 1013904223;
+            size_t index = id + writers * ((seed >> 8) % mine);
+            uint32_t n = issued[index].load(memory_order_relaxed) + 1;
+            issued[index].store(n, memory_order_release);
+            t.rollNo = int(index + 1);
+            fill(begin(t.marks), end(t.marks), float(n));
+            t.percentage = float(n);
+            directory.put(t);
+            committed[index].store(n, memory_order_release);
+            ++count.operations;
+        }
+    };
+
+    // Puts fresh roll numbers past `rows` and erases them again, keeping
+    // CHURN_LIVE of them at a time
+    constexpr size_t CHURN_LIVE = 1024;
+    atomic<size_t> churned{0}; // fresh roll numbers put so far, over all rounds
+    auto churner = [&](Count &count)
+    {
+        Student t = s;
+        while (!stop.load(memory_order_relaxed))
+        {
+            size_t next = churned.load(memory_order_relaxed);
+            t.rollNo = int(rows + 1 + next);
+            directory.put(t);
+            if (next >= CHURN_LIVE)
+                directory.erase(int(rows + 1 + next - CHURN_LIVE));
+            churned.store(next + 1, memory_order_release);
+            count.operations += 2;
+        }
+    };
+
+    auto reader = [&](size_t id, Count &count)
+    {
+        uint32_t seed = 12345 + 7919 * uint32_t(id);
+        float seen[6];
+        int seenRoll = 0;
+        auto look = [&](int roll)
+        {
+            return directory.read(roll, [&](const Student &current)
+                                  {
+                                      seenRoll = current.rollNo;
+                                      copy(begin(current.marks), end(current.marks), seen);
+                                      seen[5] = current.percentage; });
+        };
+        while (!stop.load(memory_order_relaxed))
+        {
+            seed = seed * 1664525 + 1013904223;
+            ++count.operations;
+            if (seed & 0x80000000u)
+            {
+                // Around the newest puts: absent or present, but never someone else
+                size_t put = churned.load(memory_order_acquire);
+                int roll = int(rows + 1 + put - min<size_t>(put, 64) + (seed >> 8) % 128);
+                if (look(roll) && seenRoll != roll)
+                    ++count.violations;
+                continue;
+            }
+            size_t index = (seed >> 8) % rows;
+            uint32_t low = committed[index].load(memory_order_acquire);
+            bool found = look(int(index + 1));
+            uint32_t high = issued[index].load(memory_order_acquire);
+            bool whole = found && seenRoll == int(index + 1) && all_of(seen, seen + 6, [&](float v)
+                                                                       { return v == seen[0]; });
+            if (!whole || seen[0] < low || seen[0] > high)
+                ++count.violations;
+        }
+    };
+
+    constexpr chrono::milliseconds ROUND{300};
+    cout << "Lock-free lookups of " << rows << " students with " << writers << " writer threads and one inserting and erasing ("
+         << thread::hardware_concurrency() << " cores):\n";
+    size_t violations = 0;
+    for (size_t readers = 1; readers <= 64; readers *= 2)
+    {
+        vector<Count> readCounts(readers), writeCounts(writers + 1);
+        vector<thread> threads;
+        stop = false;
+        for (size_t w = 0; w < writers; ++w)
+            threads.emplace_back(writer, w, ref(writeCounts[w]));
+        threads.emplace_back(churner, ref(writeCounts[writers]));
+        for (size_t r = 0; r < readers; ++r)
+            threads.emplace_back(reader, r, ref(readCounts[r]));
+        auto start = chrono::steady_clock::now();
+        this_thread::sleep_for(ROUND);
+        stop = true;
+        for (thread &t : threads)
+            t.join();
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        size_t reads = 0, writes = 0, wrong = 0;
+        for (const Count &c : readCounts)
+        {
+            reads += c.operations;
+            wrong += c.violations;
+        }
+        for (const Count &c : writeCounts)
+            writes += c.operations;
+        violations += wrong;
+        cout << "  " << setw(2) << readers << " readers: " << fixed << setprecision(2) << setw(7)
+             << reads / seconds / 1e6 << " M reads/sec (" << setw(5) << reads / seconds / 1e6 / readers
+             << " M per reader), " << setw(5) << writes / seconds / 1e6 << " M writes/sec, " << wrong
+             << " violations\n";
+    }
+    return violations ? 1 : 0;
+}
+
+// --memory-report FILE: bytes per student of a roster held fully in memory
+// and in a snapshot, with class, gender and attendance as symbol ids (now) and
+// as per-row strings (before)
+int memoryReport(const string &filename)
+{
+    StudentTable students;
+    RollIndex index;
+    FileHandler::SnapshotMeta meta;
+    if (FileHandler::isSnapshot(filename))
+    {
+        if (!FileHandler::mapSnapshot(filename, students, index, meta))
+            return 1;
+    }
+    else
+    {
+        if (!ifstream(filename))
+        {
+            cout << "Failed to open file: " << filename << "\n";
+            return 1;
+        }
+        students.reserve(CsvReader::estimateRows(filename), FileHandler::textBytes(filename));
+        FileHandler::loadFromFile(filename, [&](const Student &s)
+                                  { students.append(s); });
+    }
+    if (students.empty())
+    {
+        cout << "No students in " << filename << "\n";
+        return 1;
+    }
+
+    // On disk every row kept a uint32 heap offset per field, and each segment
+    // its own copy of the values it used
+    const SymbolTable &symbols = students.symbolTable();
+    double rows = students.size();
+    size_t segmentValueBytes = 0;
+    vector<size_t> seen(symbols.size(), SIZE_MAX);
+    for (size_t slot = 0; slot < students.size(); ++slot)
+    {
+        size_t segment = slot / StudentTable::SEGMENT_ROWS;
+        for (int f = StudentTable::CLASS; f <= StudentTable::ATTENDANCE; ++f)
+        {
+            uint16_t id = students.symbol(slot, StudentTable::TextField(f));
+            if (seen[id] != segment)
+            {
+                seen[id] = segment;
+                segmentValueBytes += sizeof(uint32_t) + symbols.name(id).size();
+            }
+        }
+    }
+    size_t symbolChunk = 0;
+    for (size_t id = 1; id < symbols.size(); ++id)
+        symbolChunk += sizeof(uint32_t) + symbols.name(id).size();
+
+    double names = students.nameBytes() / rows, values = symbols.memoryBytes() / rows;
+    double memoryBefore = StudentTable::rowBytesWithViews() + names + values;
+    double memoryAfter = StudentTable::rowBytes() + names + values;
+    double diskBefore = StudentTable::SYMBOL_FIELDS * sizeof(uint32_t) + segmentValueBytes / rows;
+    double diskAfter = StudentTable::SYMBOL_FIELDS * sizeof(uint16_t) + symbolChunk / rows;
+    cout << "Memory for " << students.size() << " students, " << symbols.size() - 1
+         << " distinct class/gender/attendance values:\n"
+         << fixed << setprecision(1)
+         << "  in memory (bytes/student):         before " << setw(7) << memoryBefore << "   after " << setw(7)
+         << memoryAfter << "\n"
+         << "    row columns:                     before " << setw(7) << double(StudentTable::rowBytesWithViews())
+         << "   after " << setw(7) << double(StudentTable::rowBytes()) << "\n"
+         << "  snapshot class/gender/attendance:  before " << setw(7) << diskBefore << "   after " << setw(7)
+         << diskAfter << "\n";
+    return 0;
+}
+
+// Builds a term of attendance for `rows` students in 40 classes over `days`
+// school days and answers the three history queries from the bitmaps and
+// again by scanning one record per (student, day), the way a log of marks
+// would be kept without them. The answers have to agree.
+int benchmarkAttendance(size_t rows, size_t days)
+{
+    rows = max<size_t>(rows, 1);
+    days = max<size_t>(days, 1);
+    constexpr size_t CLASSES = 40;
+    struct Mark
+    {
+        int32_t roll;
+        int32_t day;
+        uint16_t cls;
+        bool present;
+    };
+    vector<string> classNames;
+    for (size_t c = 0; c < CLASSES; ++c)
+        classNames.push_back(to_string(1 + c / 4) + char('A' + c % 4));
+
+    AttendanceLog log;
+    vector<Mark> marks;
+    marks.reserve(rows * days);
+    int32_t first = AttendanceLog::dayOf(2026, 9, 1);
+    uint32_t seed = 2026;
+    auto started = chrono::steady_clock::now();
+    for (size_t d = 0; d < days; ++d)
+    {
+        for (size_t i = 0; i < rows; ++i)
+        {
+            // Every student has their own absence rate, from 0% to 40%
+            seed = seed * 1664525 + 1013904223;
+            bool present = (seed >> 8) % 1000 >= (i * 2654435761u) % 400;
+            int32_t roll = int32_t(i + 1);
+            log.mark(classNames[i % CLASSES], first + int32_t(d), roll, present);
+            marks.push_back(Mark{roll, first + int32_t(d), uint16_t(i % CLASSES), present});
+        }
+    }
+    double build = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+    cout << "Attendance of " << rows << " students over " << days << " days: " << marks.size() << " marks in "
+         << log.registerCount() << " registers, recorded in " << fixed << setprecision(1) << build * 1000 << " ms\n"
+         << "  bitmaps " << log.memoryBytes() / 1024 << " KB, one record per mark "
+         << marks.size() * sizeof(Mark) / 1024 << " KB\n";
+
+    int32_t from = first + int32_t(days / 4), to = first + int32_t(days - 1);
+    size_t mismatches = 0;
+    auto time = [](auto fn)
+    {
+        auto start = chrono::steady_clock::now();
+        fn();
+        return chrono::duration<double>(chrono::steady_clock::now() - start).count() * 1000;
+    };
+
+    // Students below 75% over the range
+    vector<int> bitmapBelow, scanBelow;
+    double bitmapMs = time([&]
+                           { bitmapBelow = log.below(from, to, 75); });
+    double scanMs = time([&]
+                         {
+                             vector<uint32_t> present(rows + 1), marked(rows + 1);
+                             for (const Mark &m : marks)
+                             {
+                                 if (m.day >= from && m.day <= to)
+                                 {
+                                     ++marked[m.roll];
+                                     present[m.roll] += m.present;
+                                 }
+                             }
+                             for (size_t r = 1; r <= rows; ++r)
+                             {
+                                 if (marked[r] && 100 * present[r] < 75 * marked[r])
+                                     scanBelow.push_back(int(r));
+                             } });
+    mismatches += bitmapBelow != scanBelow;
+    cout << "  below 75%:          " << setw(8) << bitmapBelow.size() << " students   bitmaps " << setprecision(2)
+         << setw(8) << bitmapMs << " ms   scan " << setw(8) << scanMs << " ms\n";
+
+    // Daily absences of every class over the range
+    vector<uint64_t> bitmapAbsent(days * CLASSES), scanAbsent(days * CLASSES);
+    bitmapMs = time([&]
+                    { log.forRegisters(from, to, [&](int32_t day, string_view cls, const AttendanceLog::Register &r)
+                                       {
+                                           size_t c = find(classNames.begin(), classNames.end(), cls) - classNames.begin();
+                                           bitmapAbsent[(day - first) * CLASSES + c] = r.absent.cardinality(); }); });
+    scanMs = time([&]
+                  {
+                      for (const Mark &m : marks)
+                      {
+                          if (m.day >= from && m.day <= to && !m.present)
+                              ++scanAbsent[(m.day - first) * CLASSES + m.cls];
+                      } });
+    mismatches += bitmapAbsent != scanAbsent;
+    cout << "  daily absences:     " << setw(8) << (to - from + 1) * CLASSES << " counts     bitmaps " << setw(8)
+         << bitmapMs << " ms   scan " << setw(8) << scanMs << " ms\n";
+
+    // Rates of a sample of students
+    constexpr size_t SAMPLE = 1000;
+    vector<AttendanceLog::Rate> bitmapRates(SAMPLE), scanRates(SAMPLE);
+    bitmapMs = time([&]
+                    {
+                        for (size_t k = 0; k < SAMPLE; ++k)
+                            bitmapRates[k] = log.rateOf(int(k * rows / SAMPLE + 1), from, to);
+                    });
+    scanMs = time([&]
+                  {
+                      for (size_t k = 0; k < SAMPLE; ++k)
+                      {
+                          int roll = int(k * rows / SAMPLE + 1);
+                          for (const Mark &m : marks)
+                          {
+                              if (m.roll == roll && m.day >= from && m.day <= to)
+                              {
+                                  ++scanRates[k].marked;
+                                  scanRates[k].present += m.present;
+                              }
+                          }
+                      } });
+    for (size_t k = 0; k < SAMPLE; ++k)
+        mismatches += bitmapRates[k].present != scanRates[k].present || bitmapRates[k].marked != scanRates[k].marked;
+    cout << "  " << SAMPLE << " student rates: " << setw(8) << SAMPLE << " students   bitmaps " << setw(8)
+         << bitmapMs << " ms   scan " << setw(8) << scanMs << " ms\n";
+
+    // The history survives a round trip through its snapshot encoding
+    string bytes;
+    log.encode(bytes);
+    AttendanceLog copy;
+    if (!copy.decode(bytes) || copy.below(from, to, 75) != bitmapBelow)
+        ++mismatches;
+    cout << "  encoded history: " << bytes.size() / 1024 << " KB\n";
+    if (mismatches)
+        cout << "Warning: " << mismatches << " answers differ between the bitmaps and the scan.\n";
+    else
+        cout << "Bitmap answers match the scan.\n";
+    return mismatches ? 1 : 0;
+}
+
 // ==================== Main Function ====================
 
-int main()
+int main(int argc, char *argv[])
 {
-    MenuSystem system;
+    if (argc == 4 && string(argv[1]) == "--convert")
+    {
+        return FileHandler::convert(argv[2], argv[3]) ? 0 : 1;
+    }
+    if (argc == 3 && string(argv[1]) == "--bench-grading")
+    {
+        return benchmarkGrading(strtoull(argv[2], nullptr, 10));
+    }
+    if (argc == 3 && string(argv[1]) == "--bench-strategies")
+    {
+        return benchmarkStrategies(strtoull(argv[2], nullptr, 10));
+    }
+    if (argc == 3 && string(argv[1]) == "--bench-sort")
+    {
+        return benchmarkSort(strtoull(argv[2], nullptr, 10));
+    }
+    if (argc == 3 && string(argv[1]) == "--bench-load")
+    {
+        return benchmarkLoad(argv[2]);
+    }
+    if (argc == 3 && string(argv[1]) == "--memory-report")
+    {
+        return memoryReport(argv[2]);
+    }
+    // --bench-lookups ROWS [WRITERS] stress-tests lock-free lookups under concurrent writes
+    if ((argc == 3 || argc == 4) && string(argv[1]) == "--bench-lookups")
+    {
+        return benchmarkLookups(strtoull(argv[2], nullptr, 10), argc == 4 ? strtoull(argv[3], nullptr, 10) : 2);
+    }
+    // --bench-attendance STUDENTS DAYS times the attendance history queries
+    if (argc == 4 && string(argv[1]) == "--bench-attendance")
+    {
+        return benchmarkAttendance(strtoull(argv[2], nullptr, 10), strtoull(argv[3], nullptr, 10));
+    }
+    // --load SOCKET [CLIENTS [REQUESTS [MIX]]] tests a running server
+    if (argc >= 3 && argc <= 6 && string(argv[1]) == "--load")
+    {
+        return benchmarkServer(argv[2], argc > 3 ? strtoull(argv[3], nullptr, 10) : 4,
+                               argc > 4 ? strtoull(argv[4], nullptr, 10) : 100000, argc > 5 ? argv[5] : "80/15/5");
+    }
+
+    // --threads N sets the worker count for bulk work (default: one per core);
+    // --verify-stats checks every statistics query and sorted view against a full recompute;
+    // --batch FILE runs the commands in FILE (- for stdin) instead of the menus;
+    // --serve SOCKET serves the roster to clients on a Unix domain socket, with --threads workers
+    Options options;
+    for (int i = 1; i < argc; ++i)
+    {
+        string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc)
+        {
+            options.threads = max(atoi(argv[++i]), 1);
+        }
+        else if (arg == "--verify-stats")
+        {
+            options.verifyStats = true;
+        }
+        else if (arg == "--batch" && i + 1 < argc)
+        {
+            options.batch = argv[++i];
+        }
+        else if (arg == "--serve" && i + 1 < argc)
+        {
+            options.serve = argv[++i];
+        }
+        else
+        {
+            cout << "Unknown option: " << arg << "\n";
+            return 1;
+        }
+    }
+
+    // Batch output is only flushed when the buffer fills or the run ends
+    if (!options.batch.empty())
+        ios::sync_with_stdio(false);
+    if (!options.serve.empty())
+        RosterServer::blockStopSignals();
+    MenuSystem system(options);
+    if (!options.batch.empty())
+        return system.runBatch(options.batch);
+    if (!options.serve.empty())
+        return system.runServer(options.serve, options.threads);
     system.run();
     return 0;
-}
\ No newline at end of file
+}
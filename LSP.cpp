@@ -7,6 +7,7 @@
 #include <map>
 #include <functional>
 #include <memory>
+#include <cstdint>
 using namespace std;
 
 // ==================== Base Classes (Following LSP) ====================
@@ -159,12 +160,169 @@ public:
     }
 };
 
+// ==================== Indexes ====================
+
+// Open-addressing hash index from roll number to the slot of that student in the
+// students vector. Linear probing over a power-of-two table; erase uses backward
+// shifting so lookups never have to step over tombstones.
+class RollIndex {
+    struct Entry {
+        int rollNo;
+        uint32_t slot;
+    };
+
+    static constexpr uint32_t EMPTY = 0xFFFFFFFFu;
+
+    vector<Entry> table;
+    size_t count = 0;
+    size_t mask = 0;
+
+    size_t home(int rollNo) const {
+        // Fibonacci hashing so consecutive roll numbers spread over the table
+        uint64_t h = static_cast<uint32_t>(rollNo) * 0x9E3779B97F4A7C15ull;
+        return static_cast<size_t>(h >> 32) & mask;
+    }
+
+    void rehash(size_t capacity) {
+        vector<Entry> old;
+        old.swap(table);
+        table.assign(capacity, Entry{0, EMPTY});
+        mask = capacity - 1;
+        for (const auto& e : old) {
+            if (e.slot == EMPTY)
+                continue;
+            size_t i = home(e.rollNo);
+            while (table[i].slot != EMPTY)
+                i = (i + 1) & mask;
+            table[i] = e;
+        }
+    }
+
+public:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    RollIndex() { rehash(16); }
+
+    size_t size() const { return count; }
+
+    void clear() {
+        count = 0;
+        rehash(16);
+    }
+
+    // Make room for n entries without growing again (load factor stays <= 0.7)
+    void reserve(size_t n) {
+        size_t capacity = table.size();
+        while (n * 10 > capacity * 7)
+            capacity *= 2;
+        if (capacity != table.size())
+            rehash(capacity);
+    }
+
+    size_t find(int rollNo) const {
+        for (size_t i = home(rollNo);; i = (i + 1) & mask) {
+            if (table[i].slot == EMPTY)
+                return npos;
+            if (table[i].rollNo == rollNo)
+                return table[i].slot;
+        }
+    }
+
+    // Returns false (and leaves the index untouched) if rollNo is already present
+    bool insert(int rollNo, size_t slot) {
+        reserve(count + 1);
+        size_t i = home(rollNo);
+        for (; table[i].slot != EMPTY; i = (i + 1) & mask) {
+            if (table[i].rollNo == rollNo)
+                return false;
+        }
+        table[i] = Entry{rollNo, static_cast<uint32_t>(slot)};
+        ++count;
+        return true;
+    }
+
+    // Repoint an existing roll number at a new slot (used when records move)
+    void update(int rollNo, size_t slot) {
+        for (size_t i = home(rollNo); table[i].slot != EMPTY; i = (i + 1) & mask) {
+            if (table[i].rollNo == rollNo) {
+                table[i].slot = static_cast<uint32_t>(slot);
+                return;
+            }
+        }
+    }
+
+    bool erase(int rollNo) {
+        size_t i = home(rollNo);
+        for (; table[i].slot != EMPTY; i = (i + 1) & mask) {
+            if (table[i].rollNo == rollNo)
+                break;
+        }
+        if (table[i].slot == EMPTY)
+            return false;
+
+        // Backward-shift the rest of the probe run into the hole
+        size_t hole = i;
+        for (size_t j = (i + 1) & mask; table[j].slot != EMPTY; j = (j + 1) & mask) {
+            size_t h = home(table[j].rollNo);
+            bool movable = (hole <= j) ? (h <= hole || h > j) : (h <= hole && h > j);
+            if (movable) {
+                table[hole] = table[j];
+                hole = j;
+            }
+        }
+        table[hole].slot = EMPTY;
+        --count;
+        return true;
+    }
+};
+
+
 // ==================== Student Operations ====================
 
 class StudentOperations {
 protected:
     vector<Student> students;
+    RollIndex rollIndex; // rollNo -> slot in students, kept in sync by every mutation
     GradeCalculator gradeCalc;
+
+    Student* findByRoll(int roll) {
+        size_t slot = rollIndex.find(roll);
+        return slot == RollIndex::npos ? nullptr : &students[slot];
+    }
+
+    const Student* findByRoll(int roll) const {
+        size_t slot = rollIndex.find(roll);
+        return slot == RollIndex::npos ? nullptr : &students[slot];
+    }
+
+    // Appends a student unless the roll number is already taken
+    bool addRecord(const Student& s) {
+        if (!rollIndex.insert(s.rollNo, students.size()))
+            return false;
+        students.push_back(s);
+        return true;
+    }
+
+    // O(1) delete: the last record is moved into the freed slot
+    bool removeByRoll(int roll) {
+        size_t slot = rollIndex.find(roll);
+        if (slot == RollIndex::npos)
+            return false;
+        rollIndex.erase(roll);
+        if (slot != students.size() - 1) {
+            students[slot] = move(students.back());
+            rollIndex.update(students[slot].rollNo, slot);
+        }
+        students.pop_back();
+        return true;
+    }
+
+    void rebuildIndex() {
+        rollIndex.clear();
+        rollIndex.reserve(students.size());
+        for (size_t i = 0; i < students.size(); ++i)
+            rollIndex.insert(students[i].rollNo, i);
+    }
     
 public:
     explicit StudentOperations(shared_ptr<IGradeStrategy> strategy) 
@@ -177,6 +335,10 @@ public:
         getline(cin, s.name);
         cout << "Enter roll number: "; 
         cin >> s.rollNo;
+        if (findByRoll(s.rollNo)) {
+            cout << "A student with roll number " << s.rollNo << " already exists.\n";
+            return;
+        }
         cout << "Enter class: "; 
         cin.ignore();
         getline(cin, s.studentClass);
@@ -187,7 +349,7 @@ public:
         getline(cin, s.gender);
         
         gradeCalc.calculateGrade(s);
-        students.push_back(s);
+        addRecord(s);
         cout << "Student added successfully.\n";
     }
 
@@ -208,11 +370,8 @@ public:
         cout << "Enter roll number: ";
         cin >> roll;
         
-        auto it = find_if(students.begin(), students.end(), 
-            [roll](const Student& s) { return s.rollNo == roll; });
-            
-        if (it != students.end()) {
-            const auto& s = *it;
+        if (const Student* found = findByRoll(roll)) {
+            const auto& s = *found;
             cout << "\nStudent Details:\n"
                  << "Name: " << s.name << "\n"
                  << "Class: " << s.studentClass << "\n"
@@ -230,11 +389,8 @@ public:
         cout << "Enter roll number to update: ";
         cin >> roll;
         
-        auto it = find_if(students.begin(), students.end(), 
-            [roll](const Student& s) { return s.rollNo == roll; });
-            
-        if (it != students.end()) {
-            Student& s = *it;
+        if (Student* found = findByRoll(roll)) {
+            Student& s = *found;
             cout << "Enter new name: ";
             cin.ignore();
             getline(cin, s.name);
@@ -258,11 +414,7 @@ public:
         cout << "Enter roll number to delete: ";
         cin >> roll;
         
-        auto new_end = remove_if(students.begin(), students.end(),
-            [roll](const Student& s) { return s.rollNo == roll; });
-            
-        if (new_end != students.end()) {
-            students.erase(new_end, students.end());
+        if (removeByRoll(roll)) {
             cout << "Student deleted successfully.\n";
         } else {
             cout << "Student not found.\n";
@@ -272,6 +424,7 @@ public:
     virtual void sortStudents() {
         sort(students.begin(), students.end(),
             [](const Student& a, const Student& b) { return a.rollNo < b.rollNo; });
+        rebuildIndex();
         cout << "Students sorted by roll number.\n";
     }
 
@@ -281,10 +434,16 @@ public:
     }
 
     void loadData() {
-        students = FileHandler::loadFromFile();
-        for (auto& s : students) {
+        students.clear();
+        rollIndex.clear();
+        size_t duplicates = 0;
+        for (auto& s : FileHandler::loadFromFile()) {
             gradeCalc.calculateGrade(s);
+            if (!addRecord(s))
+                ++duplicates;
         }
+        if (duplicates)
+            cout << "Warning: skipped " << duplicates << " records with duplicate roll numbers.\n";
     }
 };
 
@@ -316,11 +475,8 @@ public:
         cout << "Enter roll number: ";
         cin >> roll;
         
-        auto it = find_if(students.begin(), students.end(),
-            [roll](const Student& s) { return s.rollNo == roll; });
-            
-        if (it != students.end()) {
-            Student& s = *it;
+        if (Student* found = findByRoll(roll)) {
+            Student& s = *found;
             cout << "Enter marks for 5 subjects (space separated): ";
             for (int i = 0; i < 5; ++i) {
                 cin >> s.marks[i];